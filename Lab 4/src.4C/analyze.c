@@ -0,0 +1,353 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analyze.h"
+#include "hash.h"
+
+static const char *analyze_stream_names[ANALYZE_NUM_STREAMS] = {
+  "INST", "DATA",
+};
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+//---- Fenwick tree over sampled-access timestamps ------
+
+static void analyze_fenwick_add(Analyze_Stream *s, uns64 time, int64 value){
+  uns64 ii;
+  for(ii=time+1; ii<=s->fenwick_size; ii+=ii&(-ii)){
+    s->fenwick[ii] += value;
+  }
+}
+
+static uns64 analyze_fenwick_sum(Analyze_Stream *s, uns64 time){
+  uns64 sum=0, ii;
+  for(ii=time+1; ii>0; ii-=ii&(-ii)){
+    sum += s->fenwick[ii];
+  }
+  return sum;
+}
+
+//---- Hash of sampled lines ------
+
+static Analyze_Line *analyze_line_probe(Analyze_Stream *s, Addr lineaddr){
+  uns64 mask = s->num_lines - 1;
+  uns64 idx = hash_mix(lineaddr) & mask;
+
+  while(s->lines[idx].valid && s->lines[idx].lineaddr != lineaddr){
+    idx = (idx + 1) & mask;
+  }
+  return &s->lines[idx];
+}
+
+static void analyze_line_grow(Analyze_Stream *s){
+  Analyze_Line *old = s->lines;
+  uns64 old_num = s->num_lines;
+  uns64 ii;
+
+  s->num_lines = 2*old_num;
+  s->lines = (Analyze_Line *) calloc (s->num_lines, sizeof(Analyze_Line));
+  for(ii=0; ii<old_num; ii++){
+    if(old[ii].valid){
+      *analyze_line_probe(s, old[ii].lineaddr) = old[ii];
+    }
+  }
+  free(old);
+}
+
+//---- Renumber timestamps when the Fenwick tree is full ------
+
+static int analyze_compare_time(const void *a, const void *b){
+  const Analyze_Line *la = *(Analyze_Line * const *) a;
+  const Analyze_Line *lb = *(Analyze_Line * const *) b;
+  return (la->last_time > lb->last_time) - (la->last_time < lb->last_time);
+}
+
+static void analyze_compact(Analyze_Stream *s){
+  Analyze_Line **live = (Analyze_Line **) malloc (s->used_lines * sizeof(Analyze_Line *) + 1);
+  uns64 num=0, ii;
+
+  for(ii=0; ii<s->num_lines; ii++){
+    if(s->lines[ii].valid){
+      live[num++] = &s->lines[ii];
+    }
+  }
+  qsort(live, num, sizeof(Analyze_Line *), analyze_compare_time);
+
+  if(2*num > s->fenwick_size){
+    s->fenwick_size *= 2;
+    free(s->fenwick);
+    s->fenwick = (uns64 *) malloc ((s->fenwick_size+1) * sizeof(uns64));
+  }
+  memset(s->fenwick, 0, (s->fenwick_size+1) * sizeof(uns64));
+
+  for(ii=0; ii<num; ii++){
+    live[ii]->last_time = ii;
+    analyze_fenwick_add(s, ii, 1);
+  }
+  s->time = num;
+
+  free(live);
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static void analyze_stream_init(Analyze_Stream *s){
+  s->num_lines = ANALYZE_INIT_ENTRIES;
+  s->lines = (Analyze_Line *) calloc (s->num_lines, sizeof(Analyze_Line));
+  s->fenwick_size = ANALYZE_INIT_TIME;
+  s->fenwick = (uns64 *) calloc (s->fenwick_size+1, sizeof(uns64));
+}
+
+Analyze *analyze_new(uns64 sample_mod, uns64 linesize){
+  Analyze *a = (Analyze *) calloc (1, sizeof (Analyze));
+  int ii;
+
+  assert(sample_mod >= 1);
+  a->sample_mod = sample_mod;
+  a->linesize = linesize;
+
+  for(ii=0; ii<ANALYZE_NUM_STREAMS; ii++){
+    analyze_stream_init(&a->stream[ii]);
+  }
+
+  a->num_pcs = ANALYZE_INIT_ENTRIES;
+  a->pcs = (Analyze_PC *) calloc (a->num_pcs, sizeof(Analyze_PC));
+
+  return a;
+}
+
+//////////////////////////////////////////////////////////////////
+// Reuse distance and working set of one sampled line
+//////////////////////////////////////////////////////////////////
+
+static void analyze_stream_access(Analyze *a, Analyze_Stream *s, Addr lineaddr){
+  Analyze_Line *line = analyze_line_probe(s, lineaddr);
+
+  s->stat_sampled++;
+
+  if(!line->valid){
+    if(2*(s->used_lines+1) > s->num_lines){
+      analyze_line_grow(s);
+      line = analyze_line_probe(s, lineaddr);
+    }
+    line->valid = TRUE;
+    line->lineaddr = lineaddr;
+    line->last_interval = s->cur_interval;
+    s->used_lines++;
+    s->ws_lines++;
+    s->stat_cold++;
+  }
+  else{
+    // distinct sampled lines touched since the last use, scaled up
+    uns64 dist = analyze_fenwick_sum(s, s->time-1) - analyze_fenwick_sum(s, line->last_time);
+    uns64 bucket = 0;
+
+    dist *= a->sample_mod;
+    while(dist){
+      bucket++;
+      dist >>= 1;
+    }
+    if(bucket >= ANALYZE_HIST_BUCKETS){
+      bucket = ANALYZE_HIST_BUCKETS-1;
+    }
+    s->hist[bucket]++;
+
+    analyze_fenwick_add(s, line->last_time, -1);
+
+    if(line->last_interval != s->cur_interval){
+      line->last_interval = s->cur_interval;
+      s->ws_lines++;
+    }
+  }
+
+  line->last_time = s->time;
+  analyze_fenwick_add(s, s->time, 1);
+  s->time++;
+
+  if(s->time == s->fenwick_size){
+    analyze_compact(s);
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// Per-PC data strides (in lines), keeping the most frequent ones
+//////////////////////////////////////////////////////////////////
+
+static Analyze_PC *analyze_pc_lookup(Analyze *a, Addr pc){
+  uns64 mask = a->num_pcs - 1;
+  uns64 idx = hash_mix(pc) & mask;
+
+  while(a->pcs[idx].valid && a->pcs[idx].pc != pc){
+    idx = (idx + 1) & mask;
+  }
+
+  if(!a->pcs[idx].valid && 2*(a->used_pcs+1) > a->num_pcs){
+    Analyze_PC *old = a->pcs;
+    uns64 old_num = a->num_pcs;
+    uns64 ii;
+
+    a->num_pcs = 2*old_num;
+    a->pcs = (Analyze_PC *) calloc (a->num_pcs, sizeof(Analyze_PC));
+    a->used_pcs = 0;
+    for(ii=0; ii<old_num; ii++){
+      if(old[ii].valid){
+        *analyze_pc_lookup(a, old[ii].pc) = old[ii];
+      }
+    }
+    free(old);
+    return analyze_pc_lookup(a, pc);
+  }
+
+  if(!a->pcs[idx].valid){
+    a->pcs[idx].valid = TRUE;
+    a->pcs[idx].pc = pc;
+    a->used_pcs++;
+  }
+  return &a->pcs[idx];
+}
+
+static void analyze_stride(Analyze *a, Addr pc, Addr lineaddr){
+  Analyze_PC *e = analyze_pc_lookup(a, pc);
+  int64 stride = (int64)(lineaddr - e->last_line);
+  int   ii, empty=-1;
+
+  if(e->accesses++ == 0){
+    e->last_line = lineaddr;
+    return;
+  }
+  e->last_line = lineaddr;
+
+  for(ii=0; ii<ANALYZE_MAX_STRIDES; ii++){
+    if(e->count[ii] && e->stride[ii] == stride){
+      e->count[ii]++;
+      return;
+    }
+    if(!e->count[ii] && empty < 0){
+      empty = ii;
+    }
+  }
+
+  if(empty >= 0){
+    e->stride[empty] = stride;
+    e->count[empty] = 1;
+    return;
+  }
+
+  for(ii=0; ii<ANALYZE_MAX_STRIDES; ii++){
+    e->count[ii]--;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void analyze_access(Analyze *a, Addr pc, Addr lineaddr, Access_Type type){
+  Analyze_Stream_Type st = (type == ACCESS_TYPE_IFETCH) ? ANALYZE_INST : ANALYZE_DATA;
+
+  if(st == ANALYZE_DATA){
+    analyze_stride(a, pc, lineaddr);
+  }
+
+  if(hash_mix(lineaddr) % a->sample_mod == 0){
+    analyze_stream_access(a, &a->stream[st], lineaddr);
+  }
+}
+
+void analyze_interval_end(Analyze *a, uns64 inst){
+  int ii;
+
+  for(ii=0; ii<ANALYZE_NUM_STREAMS; ii++){
+    Analyze_Stream *s = &a->stream[ii];
+
+    if(s->ws_series_len == s->ws_series_cap){
+      s->ws_series_cap = s->ws_series_cap ? 2*s->ws_series_cap : 64;
+      s->ws_series = (uns64 *) realloc (s->ws_series, s->ws_series_cap * sizeof(uns64));
+      s->ws_series_inst = (uns64 *) realloc (s->ws_series_inst, s->ws_series_cap * sizeof(uns64));
+    }
+    s->ws_series_inst[s->ws_series_len] = inst;
+    s->ws_series[s->ws_series_len++] = s->ws_lines;
+    s->ws_lines = 0;
+    s->cur_interval++;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static int analyze_compare_pc(const void *a, const void *b){
+  const Analyze_PC *pa = (const Analyze_PC *) a;
+  const Analyze_PC *pb = (const Analyze_PC *) b;
+
+  if(pa->accesses != pb->accesses){
+    return (pa->accesses < pb->accesses) ? 1 : -1;
+  }
+  return (pa->pc > pb->pc) - (pa->pc < pb->pc);
+}
+
+static void analyze_print_stream(Analyze *a, Analyze_Stream *s, const char *name){
+  uns64 reuses=0, cum=0, max_bucket=0, ii;
+
+  for(ii=0; ii<ANALYZE_HIST_BUCKETS; ii++){
+    reuses += s->hist[ii];
+    if(s->hist[ii]){
+      max_bucket = ii;
+    }
+  }
+
+  printf("\nANALYZE_%s_ACCESS_EST   \t\t : %10llu", name, s->stat_sampled * a->sample_mod);
+  printf("\nANALYZE_%s_FOOTPRINT_KB \t\t : %10llu", name, s->stat_cold * a->sample_mod * a->linesize / 1024);
+
+  // bucket k holds distances in [2^(k-1), 2^k) lines: all reuses up to
+  // bucket k hit in a fully associative LRU cache of 2^k lines
+  printf("\nANALYZE_%s_REUSE  %12s %12s %12s %10s", name, "<LINES", "CACHE_KB", "COUNT", "CUM_HIT%");
+  for(ii=0; ii<=max_bucket && reuses; ii++){
+    uns64 lines = 1ULL << ii;
+    cum += s->hist[ii];
+    printf("\nANALYZE_%s_REUSE  %12llu %12.1f %12llu %10.3f", name, lines,
+           (double)(lines * a->linesize)/1024.0, s->hist[ii] * a->sample_mod,
+           100.0*(double)cum/(double)(reuses + s->stat_cold));
+  }
+
+  printf("\nANALYZE_%s_WSS    %12s %12s %12s", name, "INTERVAL", "END_INST", "WSS_KB");
+  for(ii=0; ii<s->ws_series_len; ii++){
+    printf("\nANALYZE_%s_WSS    %12llu %12llu %12llu", name, ii, s->ws_series_inst[ii],
+           s->ws_series[ii] * a->sample_mod * a->linesize / 1024);
+  }
+  printf("\n");
+}
+
+void analyze_print(Analyze *a){
+  Analyze_PC *sorted = (Analyze_PC *) malloc (a->used_pcs * sizeof(Analyze_PC) + 1);
+  uns64 num=0, ii;
+  int   jj;
+
+  printf("\n\nANALYZE_SAMPLE_RATE    \t\t : %10.6f", 1.0/(double)a->sample_mod);
+  for(jj=0; jj<ANALYZE_NUM_STREAMS; jj++){
+    analyze_print_stream(a, &a->stream[jj], analyze_stream_names[jj]);
+  }
+
+  for(ii=0; ii<a->num_pcs; ii++){
+    if(a->pcs[ii].valid){
+      sorted[num++] = a->pcs[ii];
+    }
+  }
+  qsort(sorted, num, sizeof(Analyze_PC), analyze_compare_pc);
+
+  printf("\nANALYZE_STRIDE_PCS     \t\t : %10llu", num);
+  printf("\nANALYZE_STRIDE %18s %12s   STRIDE(lines):COUNT", "PC", "ACCESSES");
+  for(ii=0; ii<num && ii<ANALYZE_TOPN; ii++){
+    printf("\nANALYZE_STRIDE %#18llx %12llu  ", sorted[ii].pc, sorted[ii].accesses);
+    for(jj=0; jj<ANALYZE_MAX_STRIDES; jj++){
+      if(sorted[ii].count[jj]){
+        printf(" %lld:%llu", sorted[ii].stride[jj], sorted[ii].count[jj]);
+      }
+    }
+  }
+  printf("\n");
+
+  free(sorted);
+}
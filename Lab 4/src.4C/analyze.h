@@ -0,0 +1,94 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include "types.h"
+
+#define ANALYZE_HIST_BUCKETS   40    // log2 buckets of reuse distance (in lines)
+#define ANALYZE_MAX_STRIDES    4     // strides tracked per PC (Misra-Gries)
+#define ANALYZE_TOPN           10    // PCs printed in the stride report
+#define ANALYZE_INIT_ENTRIES   4096  // initial hash table size (power of two)
+#define ANALYZE_INIT_TIME      65536 // initial Fenwick tree size
+
+//////////////////////////////////////////////////////////////////
+// Trace characterization (-analyze N): working set per interval,
+// reuse (LRU stack) distance histogram and per-PC data strides,
+// computed from the line addresses that memsys_access sees.
+//
+// Working set and reuse distance use SHARDS spatial sampling: only
+// lines whose hash is 0 mod N are tracked, and their counts and
+// distances are scaled by N, so memory is ~1/N of the footprint.
+// Instruction and data lines are kept as separate streams.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Analyze_Line Analyze_Line;
+typedef struct Analyze_Stream Analyze_Stream;
+typedef struct Analyze_PC Analyze_PC;
+typedef struct Analyze Analyze;
+
+typedef enum Analyze_Stream_Enum {
+    ANALYZE_INST=0,
+    ANALYZE_DATA=1,
+    ANALYZE_NUM_STREAMS=2,
+} Analyze_Stream_Type;
+
+
+struct Analyze_Line {
+  Flag   valid;
+  Addr   lineaddr;
+  uns64  last_time;      // sampled-access timestamp of the last use
+  uns64  last_interval;  // working-set interval of the last use
+};
+
+
+struct Analyze_Stream {
+  Analyze_Line *lines;         // hash of sampled lines
+  uns64         num_lines;     // capacity, power of two
+  uns64         used_lines;
+
+  uns64        *fenwick;       // 1 at the last_time of every live line
+  uns64         fenwick_size;
+  uns64         time;          // next sampled-access timestamp
+
+  uns64         stat_sampled;
+  uns64         stat_cold;
+  uns64         hist[ANALYZE_HIST_BUCKETS];
+
+  uns64         cur_interval;
+  uns64         ws_lines;      // sampled lines touched in cur_interval
+  uns64        *ws_series;     // sampled working set of every interval
+  uns64        *ws_series_inst; // instruction count at the end of the interval
+  uns64         ws_series_len;
+  uns64         ws_series_cap;
+};
+
+
+struct Analyze_PC {
+  Flag   valid;
+  Addr   pc;
+  Addr   last_line;
+  uns64  accesses;
+  int64  stride[ANALYZE_MAX_STRIDES];
+  uns64  count[ANALYZE_MAX_STRIDES];
+};
+
+
+struct Analyze {
+  uns64           sample_mod;
+  uns64           linesize;
+  Analyze_Stream  stream[ANALYZE_NUM_STREAMS];
+
+  Analyze_PC     *pcs;
+  uns64           num_pcs;     // capacity, power of two
+  uns64           used_pcs;
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Analyze *analyze_new(uns64 sample_mod, uns64 linesize);
+void     analyze_access(Analyze *a, Addr pc, Addr lineaddr, Access_Type type);
+void     analyze_interval_end(Analyze *a, uns64 inst);
+void     analyze_print(Analyze *a);
+
+#endif // ANALYZE_H
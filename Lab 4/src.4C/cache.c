@@ -1,8 +1,12 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/mman.h>
 
 #include "cache.h"
+#include "stats.h"
 #include <math.h>
 
 
@@ -57,6 +61,54 @@ void    cache_print_stats    (Cache *c, char *header){
   printf("\n");
 }
 
+////////////////////////////////////////////////////////////////////
+// Lookup energy events and way prediction accuracy
+////////////////////////////////////////////////////////////////////
+
+void    cache_print_lookup_stats(Cache *c, char *header){
+  double accuracy=0;
+
+  if(c->stat_waypred_correct + c->stat_waypred_wrong){
+    accuracy=(double)(c->stat_waypred_correct)/(double)(c->stat_waypred_correct + c->stat_waypred_wrong);
+  }
+
+  printf("\n%s_TAG_READS      \t\t : %10llu", header, c->stat_tag_reads);
+  printf("\n%s_DATA_READS     \t\t : %10llu", header, c->stat_data_reads);
+  printf("\n%s_DATA_WRITES    \t\t : %10llu", header, c->stat_data_writes);
+  if(c->way_pred){
+    printf("\n%s_WAYPRED_CORRECT\t\t : %10llu", header, c->stat_waypred_correct);
+    printf("\n%s_WAYPRED_WRONG  \t\t : %10llu", header, c->stat_waypred_wrong);
+    printf("\n%s_WAYPRED_ACCPERC\t\t : %10.3f", header, 100*accuracy);
+  }
+  printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////
+// Register the counters printed above with the stats registry
+////////////////////////////////////////////////////////////////////
+
+void    cache_register_stats(Cache *c, char *header){
+  stats_register(header, "READ_ACCESS",  &c->stat_read_access);
+  stats_register(header, "WRITE_ACCESS", &c->stat_write_access);
+  stats_register(header, "READ_MISS",    &c->stat_read_miss);
+  stats_register(header, "WRITE_MISS",   &c->stat_write_miss);
+  stats_register(header, "DIRTY_EVICTS", &c->stat_dirty_evicts);
+  stats_register(header, "TAG_READS",    &c->stat_tag_reads);
+  stats_register(header, "DATA_READS",   &c->stat_data_reads);
+  stats_register(header, "DATA_WRITES",  &c->stat_data_writes);
+  stats_register(header, "WAYPRED_CORRECT", &c->stat_waypred_correct);
+  stats_register(header, "WAYPRED_WRONG",   &c->stat_waypred_wrong);
+  stats_register(header, "SECTOR_MISS",  &c->stat_sector_miss);
+  stats_register(header, "EVICT_LINES",  &c->stat_evict_lines);
+  stats_register(header, "EVICT_SECTORS", &c->stat_evict_sectors);
+  if(c->comp_budget){
+    stats_register_ratio(header, "RESIDENT_LINES", &c->stat_resident_sum, &c->stat_resident_samples);
+  }
+
+  stats_register_ratio(header, "READ_MISSRATE",  &c->stat_read_miss,  &c->stat_read_access);
+  stats_register_ratio(header, "WRITE_MISSRATE", &c->stat_write_miss, &c->stat_write_access);
+}
+
 
 
 ////////////////////////////////////////////////////////////////////
@@ -67,37 +119,264 @@ void    cache_print_stats    (Cache *c, char *header){
 ////////////////////////////////////////////////////////////////////
 
 int get_bits(Addr value, int start, int end){
-  int result;
+  Addr result;
   assert(start >= end );
   result = value >> end;
-  result = result % ( 1 << ( start - end + 1 ) );
+  result = result % ( 1ULL << ( start - end + 1 ) );
   return result;
 }
 
 
 
+////////////////////////////////////////////////////////////////////
+// Way prediction: the predicted way is always probed first (a fast
+// path for the simulator too, since tags in a set are unique). The
+// lookup energy and latency are only modeled when way_pred is set.
+////////////////////////////////////////////////////////////////////
+
+static uns cache_predict_way(Cache *c, Cache_Set *set){
+  if(c->way_pred==WAYPRED_PC){
+    Addr pc = c->cur_pc ? *c->cur_pc : 0;
+    return c->waypred_table[(pc>>2) % WAYPRED_TABLE_SIZE];
+  }
+  return set->mru_way;
+}
+
+static void cache_train_way(Cache *c, Cache_Set *set, uns way){
+  set->mru_way=way;
+  if(c->way_pred==WAYPRED_PC){
+    Addr pc = c->cur_pc ? *c->cur_pc : 0;
+    c->waypred_table[(pc>>2) % WAYPRED_TABLE_SIZE]=way;
+  }
+}
+
+static void cache_account_lookup(Cache *c, Flag hit, Flag first_probe_hit){
+  if(c->way_pred==WAYPRED_NONE){
+    // all tag and data ways are read in parallel
+    c->stat_tag_reads  += c->num_ways;
+    c->stat_data_reads += c->num_ways;
+    return;
+  }
+
+  c->waypred_correct=first_probe_hit;
+  if(first_probe_hit){
+    c->stat_waypred_correct++;
+    c->stat_tag_reads++;
+    c->stat_data_reads++;
+  }else{
+    // first probe failed: read the remaining tags, then the hit way
+    c->stat_waypred_wrong++;
+    c->stat_tag_reads  += c->num_ways;
+    c->stat_data_reads += hit ? 2 : 1;
+  }
+}
+
+void    cache_enable_waypred(Cache *c, uns64 policy, uns64 latency, uns64 penalty, Addr *cur_pc){
+  c->way_pred=policy;
+  c->waypred_latency=latency;
+  c->waypred_penalty=penalty;
+  c->cur_pc=cur_pc;
+  if(policy==WAYPRED_PC){
+    c->waypred_table=(uns8 *) calloc (WAYPRED_TABLE_SIZE, sizeof(uns8));
+  }
+}
+
+uns64   cache_lookup_latency(Cache *c, uns64 hit_latency){
+  if(c->way_pred==WAYPRED_NONE){
+    return hit_latency;
+  }
+  return c->waypred_correct ? c->waypred_latency : c->waypred_latency + c->waypred_penalty;
+}
+
+////////////////////////////////////////////////////////////////////
+// Set index functions. INDEX_MODULO is the original get_bits index;
+// with INDEX_SKEW way w of a line lives in set cache_set_index(w),
+// and way 0's set holds the MRU/way predictor state.
+////////////////////////////////////////////////////////////////////
+
+// sets are set_bytes apart: with a compact layout, only num_ways lines
+static inline Cache_Set *cache_set_at(Cache *c, uns64 index){
+  return (Cache_Set *)((char *)c->sets + index*c->set_bytes);
+}
+
+static inline uns64 cache_set_number(Cache *c, Cache_Line *line){
+  return ((char *)line - (char *)c->sets)/c->set_bytes;
+}
+
+static uns64 cache_set_index(Cache *c, Addr lineaddr, uns way){
+  uns64 mask=c->num_sets-1;
+  uns64 bits=c->index_bits;
+
+  switch(c->index_policy){
+  case INDEX_XOR:
+    return (lineaddr ^ (lineaddr>>bits) ^ (lineaddr>>(2*bits))) & mask;
+  case INDEX_PRIME:
+    return lineaddr % c->index_prime;
+  case INDEX_SKEW:
+  {
+    uns64 upper=(lineaddr>>bits) & mask;
+    uns64 rot=bits ? way % bits : 0;
+    if(rot)
+      upper=((upper<<rot) | (upper>>(bits-rot))) & mask;
+    return ((lineaddr & mask) ^ upper);
+  }
+  default:
+    return lineaddr & mask;
+  }
+}
+
+static inline Cache_Line *cache_way_line(Cache *c, Cache_Set *set, Addr lineaddr, uns way){
+  if(c->index_policy==INDEX_SKEW)
+    return &cache_set_at(c, cache_set_index(c, lineaddr, way))->line[way];
+  return &set->line[way];
+}
+
+////////////////////////////////////////////////////////////////////
+// The lookup/install bodies below take the geometry as arguments and
+// are always inlined: the generic versions pass the struct fields
+// and support every index policy, the kernels pass constants (see
+// cache_select_kernels) so the way loops unroll and the set index is
+// a mask of the line address.
+////////////////////////////////////////////////////////////////////
+
+#define CACHE_INLINE static inline __attribute__((always_inline))
+
+CACHE_INLINE Cache_Set *cache_set_of(Cache *c, Addr lineaddr, uns64 sets, Flag generic){
+  if(generic)
+    return cache_set_at(c, cache_set_index(c, lineaddr, 0));
+  return cache_set_at(c, lineaddr & (sets-1));
+}
+
+CACHE_INLINE Cache_Line *cache_line_of(Cache *c, Cache_Set *set, Addr lineaddr, uns way, Flag generic){
+  if(generic)
+    return cache_way_line(c, set, lineaddr, way);
+  return &set->line[way];
+}
+
+CACHE_INLINE Cache_Line *cache_find_body(Cache *c, Cache_Set *set, Addr lineaddr, uns first, int *way,
+                                         uns ways, Flag generic){
+  Cache_Line *line=cache_line_of(c, set, lineaddr, first, generic);
+
+  if(lineaddr==line->tag && line->valid)
+  {
+      *way=first;
+      return line;
+  }
+#pragma GCC unroll 16
+  for(uns i=0; i<ways; i++)
+  {
+      line=cache_line_of(c, set, lineaddr, i, generic);
+      if(lineaddr==line->tag && line->valid)
+      {
+          *way=i;
+          return line;
+      }
+  }
+  *way=-1;
+  return NULL;
+}
+
+static void cache_count_fill(Cache *c, Cache_Line *line){
+  if(c->set_fills)
+    c->set_fills[cache_set_number(c, line)]++;
+}
+
+void    cache_set_index_policy(Cache *c, uns64 policy){
+  c->index_policy=policy;
+  c->index_bits=0;
+  while((1ULL<<c->index_bits) < c->num_sets)
+    c->index_bits++;
+
+  c->index_prime=c->num_sets;
+  if(policy==INDEX_PRIME){
+    for(uns64 p=c->num_sets; p>=2; p--){
+      uns64 d=2;
+      while(d*d<=p && p%d)
+        d++;
+      if(d*d>p){
+        c->index_prime=p;
+        break;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Insertion position: a new line gets last_access_time 0 to go in
+// at the LRU position, so it is the next victim unless it is hit
+// first. Set after cache_new and before any access.
+////////////////////////////////////////////////////////////////////
+
+void    cache_set_insertion(Cache *c, uns64 policy, uns64 bip_throttle){
+  assert(policy <= INSERT_PRED && bip_throttle >= 1);
+  c->insert_policy=policy;
+  c->bip_throttle=bip_throttle;
+}
+
+CACHE_INLINE uns cache_insert_time(Cache *c){
+  if(c->insert_policy==INSERT_MRU)
+    return cycle_count;
+  if(c->insert_policy==INSERT_BIP)
+    return (c->bip_count++ % c->bip_throttle==0) ? cycle_count : 0;
+  if(c->insert_policy==INSERT_PRED)
+    return c->insert_dead ? 0 : cycle_count;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
 Flag    cache_access(Cache *c, Addr lineaddr, uns mark_dirty){
-  Flag outcome=MISS;
+  return cache_access_sectors(c, lineaddr, c->sector_all, mark_dirty);
+}
 
-  int numberOfSets=log2((c->num_sets));
-  int LSBs=get_bits(lineaddr,(numberOfSets-1),0);
+////////////////////////////////////////////////////////////////////
+// Access the sectors in mask of the line. It is a HIT only if the
+// tag matches and every requested sector is valid; on a sector miss
+// the line stays resident and last_missing_sectors tells the caller
+// what to fetch before cache_fill.
+////////////////////////////////////////////////////////////////////
+
+Flag    cache_access_sectors(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){
+  return c->access_fn(c, lineaddr, mask, mark_dirty);
+}
 
+CACHE_INLINE Flag cache_access_body(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty,
+                                    uns ways, uns64 sets, Flag generic){
+  Flag outcome=MISS;
 
-  //Addr currentAddress=lineaddr>>numberOfSets;
+  Cache_Set *set=cache_set_of(c, lineaddr, sets, generic);
+  uns pred=cache_predict_way(c, set);
+  int hitWay;
+  Cache_Line *line=cache_find_body(c, set, lineaddr, pred, &hitWay, ways, generic);
 
-  int numberOfWays=c->num_ways;
-  for(int i=0; i<numberOfWays; i++)
+  c->last_missing_sectors=mask;
+  c->last_tag_hit=(hitWay>=0);
+  if(generic && c->comp_budget)
   {
-  	if(lineaddr==c->sets[LSBs].line[i].tag && c->sets[LSBs].line[i].valid)
-    {
+      c->stat_resident_sum+=c->comp_resident;
+      c->stat_resident_samples++;
+  }
+  if(hitWay>=0)
+  {
+      c->last_missing_sectors=mask & ~line->sector_valid;
+      c->last_touched_line=line;
+      line->last_access_time=cycle_count;
+      cache_train_way(c, set, hitWay);
+      if(c->last_missing_sectors)
+      {
+          c->stat_sector_miss++;
+      }
+      else
+      {
           outcome=HIT;
-          c->sets[LSBs].line[i].last_access_time=cycle_count;
           if(mark_dirty)
-              {c->sets[LSBs].line[i].dirty=TRUE;}
-          break;
-  	}
+              {line->dirty=TRUE; line->sector_dirty|=mask; c->stat_data_writes++;}
+      }
   }
 
+  cache_account_lookup(c, hitWay>=0, hitWay==(int)pred);
+
 
   if(mark_dirty)
   {
@@ -122,27 +401,36 @@ Flag    cache_access(Cache *c, Addr lineaddr, uns mark_dirty){
 ////////////////////////////////////////////////////////////////////
 
 void    cache_install(Cache *c, Addr lineaddr, uns mark_dirty){
+  c->install_fn(c, lineaddr, mark_dirty);
+}
 
-  int numberOfSets=log2((c->num_sets));
-  int LSBs=get_bits(lineaddr,(numberOfSets-1),0);
+CACHE_INLINE void cache_install_body(Cache *c, Addr lineaddr, uns mark_dirty,
+                                     uns ways, uns64 sets, Flag generic){
 
-  //Addr currentAddress=lineaddr>>numberOfSets;
-  Addr tag = lineaddr / c->num_sets;
+  Cache_Set *set=cache_set_of(c, lineaddr, sets, generic);
+  Cache_Line *line;
   int needToReplace=TRUE;
+  int way=0;
 
-  int numberOfWays=c->num_ways;
+  int numberOfWays=ways;
+#pragma GCC unroll 16
   for(int i=0; i<numberOfWays; i++)
   {
-  	if(c->sets[LSBs].line[i].tag==0)
+    line=cache_line_of(c, set, lineaddr, i, generic);
+    if(line->tag==0)
     {
-      c->sets[LSBs].line[i].valid=TRUE;
-      c->sets[LSBs].line[i].dirty=mark_dirty;
-      c->sets[LSBs].line[i].tag=lineaddr;
-      c->sets[LSBs].line[i].last_access_time=cycle_count;
+      line->valid=TRUE;
+      line->dirty=mark_dirty;
+      line->tag=lineaddr;
+      line->last_access_time=cache_insert_time(c);
+      line->sector_valid=c->sector_all;
+      line->sector_dirty=mark_dirty ? c->sector_all : 0;
       c->last_evicted_line.valid=FALSE;
+      c->last_touched_line=line;
+      way=i;
       needToReplace=FALSE;
       break;
-  	}
+    }
 
   }
 
@@ -151,37 +439,430 @@ void    cache_install(Cache *c, Addr lineaddr, uns mark_dirty){
     int block=0;
     if(c->repl_policy==1)
     {
-      block=rand()%(c->num_ways);
+      block=rand()%numberOfWays;
     }
     else
     {
 
-      uns minimumCycleCount=c->sets[LSBs].line[0].last_access_time;
+      uns minimumCycleCount=cache_line_of(c, set, lineaddr, 0, generic)->last_access_time;
+#pragma GCC unroll 16
       for(int i=0; i<numberOfWays;i++)
       {
-          Cache_Line currentLine=c->sets[LSBs].line[i];
-          if(currentLine.last_access_time<minimumCycleCount)
+          Cache_Line *currentLine=cache_line_of(c, set, lineaddr, i, generic);
+          if(currentLine->last_access_time<minimumCycleCount)
           {
-              minimumCycleCount=currentLine.last_access_time;
+              minimumCycleCount=currentLine->last_access_time;
               block=i;
           }
       }
 
 
     }
+    line=cache_line_of(c, set, lineaddr, block, generic);
+    way=block;
+
     // check if old is dirty before installing new line
-    if(c->sets[LSBs].line[block].dirty)
+    if(line->dirty)
         c->stat_dirty_evicts++;
 
-    c->last_evicted_line=c->sets[LSBs].line[block];
-    c->sets[LSBs].line[block].valid=TRUE;
-    c->sets[LSBs].line[block].dirty=mark_dirty;
-    c->sets[LSBs].line[block].tag=lineaddr;
-    c->sets[LSBs].line[block].last_access_time=cycle_count;
+    if(line->valid)
+    {
+        c->stat_evict_lines++;
+        c->stat_evict_sectors+=__builtin_popcountll(line->sector_valid);
+    }
+
+    c->last_evicted_line=*line;
+    line->valid=TRUE;
+    line->dirty=mark_dirty;
+    line->tag=lineaddr;
+    line->last_access_time=cache_insert_time(c);
+    line->sector_valid=c->sector_all;
+    line->sector_dirty=mark_dirty ? c->sector_all : 0;
+    c->last_touched_line=line;
+  }
+
+  c->stat_data_writes++;
+  cache_count_fill(c, c->last_touched_line);
+  cache_train_way(c, set, way);
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+// Read hit on a line the caller already knows is resident (e.g. the
+// fetch-line buffer in memsys). Same stats and LRU update as a read
+// hit in cache_access, without scanning the set.
+////////////////////////////////////////////////////////////////////
+
+void    cache_touch_line(Cache *c, Cache_Line *line){
+  // the line sits in its way's set; the MRU/way predictor state is
+  // in way 0's set, which differs from it under INDEX_SKEW
+  uns way=line - cache_set_at(c, cache_set_number(c, line))->line;
+  Cache_Set *set=cache_set_at(c, cache_set_index(c, line->tag, 0));
+  uns pred=cache_predict_way(c, set);
+
+  line->last_access_time=cycle_count;
+  c->last_touched_line=line;
+  c->stat_read_access++;
+  cache_train_way(c, set, way);
+  cache_account_lookup(c, HIT, way==pred);
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+// Sectored lines. Unsectored caches have one sector per line, so the
+// mask is always 1 and cache_access/cache_install behave as before.
+////////////////////////////////////////////////////////////////////
+
+void    cache_set_sectors(Cache *c, uns64 sectors_per_line){
+  assert(sectors_per_line >= 1 && sectors_per_line <= MAX_SECTORS);
+  c->sectors_per_line=sectors_per_line;
+  c->sector_all=(sectors_per_line==MAX_SECTORS) ? ~0ULL : ((1ULL<<sectors_per_line)-1);
+}
+
+////////////////////////////////////////////////////////////////////
+// Fill the sectors in mask after a miss. A resident line (sector
+// miss) just gains the sectors and evicts nothing; otherwise a victim
+// is replaced as in cache_install and only mask becomes valid.
+////////////////////////////////////////////////////////////////////
+
+void    cache_fill(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){
+  c->fill_fn(c, lineaddr, mask, mark_dirty);
+}
+
+CACHE_INLINE void cache_fill_body(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty,
+                                  uns ways, uns64 sets, Flag generic){
+  Cache_Set *set=cache_set_of(c, lineaddr, sets, generic);
+  int way;
+  Cache_Line *line=cache_find_body(c, set, lineaddr, set->mru_way, &way, ways, generic);
 
+  if(line)
+  {
+      line->sector_valid|=mask;
+      if(mark_dirty)
+          {line->dirty=TRUE; line->sector_dirty|=mask;}
+      line->last_access_time=cycle_count;
+      c->last_touched_line=line;
+      c->last_evicted_line.valid=FALSE;
+      c->last_evicted_line.dirty=FALSE;
+      c->stat_data_writes++;
+      cache_train_way(c, set, way);
+      return;
+  }
 
+  cache_install_body(c, lineaddr, mark_dirty, ways, sets, generic);
+  line=c->last_touched_line;
+  line->sector_valid=mask;
+  line->sector_dirty=mark_dirty ? mask : 0;
+}
+
+void    cache_print_sector_stats(Cache *c, char *header){
+  double util=0;
+
+  if(c->stat_evict_lines){
+    util=(double)(c->stat_evict_sectors)/(double)(c->stat_evict_lines*c->sectors_per_line);
   }
+
+  printf("\n%s_SECTOR_MISS     \t\t : %10llu", header, c->stat_sector_miss);
+  printf("\n%s_EVICT_LINES     \t\t : %10llu", header, c->stat_evict_lines);
+  printf("\n%s_SECTOR_UTILPERC \t\t : %10.3f", header, 100*util);
+  printf("\n");
 }
 
 ////////////////////////////////////////////////////////////////////
+// Kernels: the generic access/install/fill, and one specialized set
+// per common geometry (32 KB 8-way L1 and 512 KB/1 MB 16-way L2, with
+// 64 B or 128 B lines). cache_select_kernels picks the matching set
+// once the cache is configured; only modulo indexing of an
+// uncompressed cache is specialized, everything else is generic.
 ////////////////////////////////////////////////////////////////////
+
+static Flag cache_access_generic(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){
+  return cache_access_body(c, lineaddr, mask, mark_dirty, c->num_ways, c->num_sets, TRUE);
+}
+
+static void cache_install_generic(Cache *c, Addr lineaddr, uns mark_dirty){
+  cache_install_body(c, lineaddr, mark_dirty, c->num_ways, c->num_sets, TRUE);
+}
+
+static void cache_fill_generic(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){
+  cache_fill_body(c, lineaddr, mask, mark_dirty, c->num_ways, c->num_sets, TRUE);
+}
+
+#define CACHE_KERNEL(WAYS, SETS)                                                           \
+static Flag cache_access_##WAYS##w##SETS(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){ \
+  return cache_access_body(c, lineaddr, mask, mark_dirty, WAYS, SETS, FALSE);              \
+}                                                                                          \
+static void cache_install_##WAYS##w##SETS(Cache *c, Addr lineaddr, uns mark_dirty){        \
+  cache_install_body(c, lineaddr, mark_dirty, WAYS, SETS, FALSE);                          \
+}                                                                                          \
+static void cache_fill_##WAYS##w##SETS(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty){ \
+  cache_fill_body(c, lineaddr, mask, mark_dirty, WAYS, SETS, FALSE);                       \
+}
+
+#define CACHE_KERNEL_ENTRY(WAYS, SETS) \
+  {WAYS, SETS, cache_access_##WAYS##w##SETS, cache_install_##WAYS##w##SETS, cache_fill_##WAYS##w##SETS}
+
+CACHE_KERNEL(8, 32)     // 32 KB, 128 B lines
+CACHE_KERNEL(8, 64)     // 32 KB, 64 B lines
+CACHE_KERNEL(16, 256)   // 512 KB, 128 B lines
+CACHE_KERNEL(16, 512)   // 512 KB, 64 B lines or 1 MB, 128 B lines
+CACHE_KERNEL(16, 1024)  // 1 MB, 64 B lines
+
+typedef struct Cache_Kernel {
+  uns64 num_ways;
+  uns64 num_sets;
+  Flag (*access_fn)(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+  void (*install_fn)(Cache *c, Addr lineaddr, uns mark_dirty);
+  void (*fill_fn)(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+} Cache_Kernel;
+
+static const Cache_Kernel cache_kernels[] = {
+  CACHE_KERNEL_ENTRY(8, 32),
+  CACHE_KERNEL_ENTRY(8, 64),
+  CACHE_KERNEL_ENTRY(16, 256),
+  CACHE_KERNEL_ENTRY(16, 512),
+  CACHE_KERNEL_ENTRY(16, 1024),
+};
+
+#define NUM_CACHE_KERNELS (sizeof(cache_kernels)/sizeof(cache_kernels[0]))
+
+////////////////////////////////////////////////////////////////////
+// Host memory for the sets, once the geometry is final (after
+// cache_enable_compression, before cache_select_kernels). cache_new
+// callocs num_sets sets of MAX_WAYS lines. SET_ALLOC_LAZY and
+// SET_ALLOC_HUGE replace them with sets of num_ways lines in an
+// anonymous mapping: a lazy one is backed by small pages as sets
+// are first touched, so a large cache costs only the sets a trace
+// reaches, while a huge page one suits a densely used cache (fewer
+// host TLB misses). If the mapping fails the calloc'd sets stay.
+////////////////////////////////////////////////////////////////////
+
+#define CACHE_HOST_PAGE       4096
+#define CACHE_HOST_HUGE_PAGE  (2*1024*1024)
+
+void    cache_alloc_sets(Cache *c, uns64 policy){
+  uns64 set_bytes=offsetof(Cache_Set, line) + c->num_ways*sizeof(Cache_Line);
+  uns64 page=(policy==SET_ALLOC_HUGE) ? CACHE_HOST_HUGE_PAGE : CACHE_HOST_PAGE;
+  uns64 bytes=(c->num_sets*set_bytes + page-1) & ~(page-1);
+  char *map=MAP_FAILED;
+
+  c->set_bytes=sizeof(Cache_Set);
+  c->set_alloc=SET_ALLOC_CALLOC;
+  if(policy==SET_ALLOC_CALLOC)
+    return;
+
+  assert(set_bytes % sizeof(uns64) == 0);
+#ifdef MAP_HUGETLB
+  // reserved huge pages, if the host has enough (reserved up front,
+  // so the mapping fails here rather than faulting later)
+  if(policy==SET_ALLOC_HUGE)
+    map=mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+#endif
+  if(map==MAP_FAILED)
+  {
+      // transparent huge pages need a 2 MB aligned start: map extra and align
+      uns64 slack=(policy==SET_ALLOC_HUGE) ? page : 0;
+      char *base=mmap(NULL, bytes+slack, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+
+      if(base==MAP_FAILED)
+        return;
+      map=base;
+      if(slack)
+        map=(char *)(((uns64)base + slack-1) & ~(slack-1));
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+      madvise(map, bytes, (policy==SET_ALLOC_HUGE) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#endif
+  }
+
+  free(c->sets);
+  c->sets=(Cache_Set *)map;
+  c->set_bytes=set_bytes;
+  c->set_alloc=policy;
+  c->sets_map_bytes=bytes;
+}
+
+void    cache_select_kernels(Cache *c, Flag specialize){
+  uns ii;
+
+  assert(c->set_bytes); // cache_alloc_sets first
+
+  c->access_fn=cache_access_generic;
+  c->install_fn=cache_install_generic;
+  c->fill_fn=cache_fill_generic;
+  c->specialized=FALSE;
+
+  if(!specialize || c->index_policy!=INDEX_MODULO || c->comp_budget)
+    return;
+
+  for(ii=0; ii<NUM_CACHE_KERNELS; ii++)
+  {
+      if(cache_kernels[ii].num_ways==c->num_ways && cache_kernels[ii].num_sets==c->num_sets)
+      {
+          c->access_fn=cache_kernels[ii].access_fn;
+          c->install_fn=cache_kernels[ii].install_fn;
+          c->fill_fn=cache_kernels[ii].fill_fn;
+          c->specialized=TRUE;
+          return;
+      }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Compressed cache: each set keeps up to twice the tags of the
+// uncompressed cache, and the compressed sizes of its valid lines
+// must fit in the data array of the uncompressed set. Installs may
+// replace several lines; they are left in comp_evicted[].
+////////////////////////////////////////////////////////////////////
+
+void    cache_enable_compression(Cache *c, uns64 linesize){
+  c->comp_base_ways=c->num_ways;
+  c->comp_budget=c->num_ways*linesize;
+  c->num_ways=(2*c->num_ways > MAX_WAYS) ? MAX_WAYS : 2*c->num_ways;
+}
+
+static int cache_compressed_victim(Cache *c, Cache_Set *set){
+  int victim=-1;
+  uns num_valid=0;
+
+  for(uns i=0; i<c->num_ways; i++)
+  {
+      if(!set->line[i].valid)
+          continue;
+      num_valid++;
+      if(victim<0 || set->line[i].last_access_time<set->line[victim].last_access_time)
+          victim=i;
+  }
+
+  if(c->repl_policy==1 && num_valid)
+  {
+      uns pick=rand()%num_valid;
+      for(uns i=0; i<c->num_ways; i++)
+      {
+          if(set->line[i].valid && pick--==0)
+              return i;
+      }
+  }
+  return victim;
+}
+
+void    cache_install_compressed(Cache *c, Addr lineaddr, uns mark_dirty, uns size){
+  Cache_Set *set=cache_set_at(c, cache_set_index(c, lineaddr, 0));
+  Cache_Line *line;
+  int free_way;
+
+  c->comp_num_evicted=0;
+  for(;;)
+  {
+      int victim;
+
+      free_way=-1;
+      for(uns i=0; i<c->num_ways; i++)
+      {
+          if(!set->line[i].valid)
+              {free_way=i; break;}
+      }
+      if(free_way>=0 && set->comp_bytes+size<=c->comp_budget)
+          break;
+
+      victim=cache_compressed_victim(c, set);
+      assert(victim>=0);
+      line=&set->line[victim];
+      if(line->dirty)
+          c->stat_dirty_evicts++;
+      c->stat_evict_lines++;
+      c->stat_evict_sectors+=__builtin_popcountll(line->sector_valid);
+      c->comp_evicted[c->comp_num_evicted++]=*line;
+      set->comp_bytes-=line->comp_size;
+      c->comp_resident--;
+      memset(line, 0, sizeof(Cache_Line));
+  }
+
+  line=&set->line[free_way];
+  line->valid=TRUE;
+  line->dirty=mark_dirty;
+  line->tag=lineaddr;
+  line->last_access_time=cycle_count;
+  line->sector_valid=c->sector_all;
+  line->sector_dirty=mark_dirty ? c->sector_all : 0;
+  line->comp_size=size;
+  set->comp_bytes+=size;
+  c->comp_resident++;
+
+  c->last_evicted_line.valid=FALSE;
+  c->last_evicted_line.dirty=FALSE;
+  c->last_touched_line=line;
+  c->stat_data_writes++;
+  cache_count_fill(c, line);
+  cache_train_way(c, set, free_way);
+}
+
+void    cache_print_compress_stats(Cache *c, char *header){
+  double resident=0;
+  double gain=0;
+
+  if(c->stat_resident_samples){
+    resident=(double)(c->stat_resident_sum)/(double)(c->stat_resident_samples);
+    gain=resident/(double)(c->num_sets*c->comp_base_ways);
+  }
+
+  printf("\n%s_EVICT_LINES     \t\t : %10llu", header, c->stat_evict_lines);
+  printf("\n%s_RESIDENT_LINES  \t\t : %10.1f", header, resident);
+  printf("\n%s_CAPACITY_GAIN   \t\t : %10.3f", header, gain);
+  printf("\n");
+}
+
+////////////////////////////////////////////////////////////////////
+// Set occupancy: installs per set, summarized as the spread around
+// the mean. Conflict hotspots show up as a high max/mean and CV and
+// as sets in the top buckets; a good index leaves few unused sets.
+////////////////////////////////////////////////////////////////////
+
+void    cache_enable_set_stats(Cache *c){
+  c->set_fills=(uns64 *) calloc (c->num_sets, sizeof(uns64));
+}
+
+void    cache_print_set_stats(Cache *c, char *header){
+  static const char *bucket_names[SETSTATS_BUCKETS] = {
+    "UNUSED", "LT_HALF", "HALF_1X", "1X_2X", "2X_4X", "GT_4X",
+  };
+  uns64  hist[SETSTATS_BUCKETS]={0};
+  uns64  total=0, max=0, ii;
+  double mean, var=0, cv=0;
+
+  for(ii=0; ii<c->num_sets; ii++){
+    total+=c->set_fills[ii];
+    if(c->set_fills[ii]>max)
+      max=c->set_fills[ii];
+  }
+  mean=(double)total/(double)c->num_sets;
+
+  for(ii=0; ii<c->num_sets; ii++){
+    double fills=(double)c->set_fills[ii];
+    uns    b;
+
+    var+=(fills-mean)*(fills-mean);
+    if(c->set_fills[ii]==0)   b=0;
+    else if(fills<0.5*mean)   b=1;
+    else if(fills<mean)       b=2;
+    else if(fills<2*mean)     b=3;
+    else if(fills<4*mean)     b=4;
+    else                      b=5;
+    hist[b]++;
+  }
+  if(mean>0){
+    cv=sqrt(var/(double)c->num_sets)/mean;
+  }
+
+  printf("\n%s_SETS            \t\t : %10llu", header, c->num_sets);
+  printf("\n%s_SET_FILLS_MAX   \t\t : %10llu", header, max);
+  printf("\n%s_SET_FILLS_MEAN  \t\t : %10.3f", header, mean);
+  printf("\n%s_SET_FILLS_CV    \t\t : %10.3f", header, cv);
+  for(ii=0; ii<SETSTATS_BUCKETS; ii++){
+    printf("\n%s_SETS_%-8s    \t\t : %10llu", header, bucket_names[ii], hist[ii]);
+  }
+  printf("\n");
+}
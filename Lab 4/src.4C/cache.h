@@ -4,6 +4,37 @@
 #include "types.h"
 
 #define MAX_WAYS 64
+#define MAX_SECTORS 64 // sectors per line, one bit each in Cache_Line
+
+#define WAYPRED_TABLE_SIZE 4096 // entries in the PC-indexed way predictor
+
+typedef enum Waypred_Policy_Enum {
+    WAYPRED_NONE=0, // parallel lookup of all ways
+    WAYPRED_MRU=1,  // probe the most recently used way of the set first
+    WAYPRED_PC=2,   // probe the way last used by this PC first
+} Waypred_Policy;
+
+typedef enum Index_Policy_Enum {
+    INDEX_MODULO=0, // low bits of the line address
+    INDEX_XOR=1,    // low bits XOR the next two fields of upper bits
+    INDEX_PRIME=2,  // line address modulo the largest prime <= num_sets
+    INDEX_SKEW=3,   // skewed-associative: a different XOR hash per way
+} Index_Policy;
+
+typedef enum Insert_Policy_Enum {
+    INSERT_MRU=0,   // new lines at the MRU position (plain LRU)
+    INSERT_LIP=1,   // new lines at the LRU position, promoted on a hit
+    INSERT_BIP=2,   // LIP, but 1 in bip_throttle fills at MRU
+    INSERT_PRED=3,  // LRU if the caller predicts the line dead (insert_dead)
+} Insert_Policy;
+
+typedef enum Set_Alloc_Enum {
+    SET_ALLOC_CALLOC=0, // cache_new's calloc: every set has MAX_WAYS lines
+    SET_ALLOC_LAZY=1,   // num_ways lines per set, host pages on first touch
+    SET_ALLOC_HUGE=2,   // num_ways lines per set on host huge pages
+} Set_Alloc;
+
+#define SETSTATS_BUCKETS 6 // set fill histogram, relative to the mean
 
 typedef struct Cache_Line Cache_Line;
 typedef struct Cache_Set Cache_Set;
@@ -16,14 +47,22 @@ typedef struct Cache Cache;
 struct Cache_Line {
     Flag    valid;
     Flag    dirty;
+    Flag    reused;           // reuse predictor: demand hit since the fill
+    Flag    pred_dead;        // reuse predictor: predicted dead at the fill
     Addr    tag;
     uns    last_access_time; // for LRU
+    uns64  sector_valid;     // one bit per sector (all set when unsectored)
+    uns64  sector_dirty;
+    uns    comp_size;        // bytes used in a compressed cache
+    uns    reuse_sig;        // reuse predictor: PC signature of the fill
    // Note: No data as we are only estimating hit/miss 
 };
 
 
 struct Cache_Set {
-    Cache_Line line[MAX_WAYS];
+    uns8       mru_way;
+    uns        comp_bytes;   // bytes of compressed lines held
+    Cache_Line line[MAX_WAYS]; // last: only num_ways are mapped (cache_alloc_sets)
 };
 
 
@@ -32,8 +71,49 @@ struct Cache{
   uns64 num_ways;
   uns64 repl_policy;
   
-  Cache_Set *sets;
+  Cache_Set *sets;          // stride set_bytes, not sizeof(Cache_Set)
+  uns64  set_bytes;
+  uns64  set_alloc;         // Set_Alloc of sets
+  uns64  sets_map_bytes;    // size of the mapping, 0 if calloc'd
+  uns64  index_policy;
+  uns64  index_bits;        // log2(num_sets)
+  uns64  index_prime;       // INDEX_PRIME modulus
+  uns64 *set_fills;         // installs per set, NULL unless set stats are on
+
+  // access/install/fill kernels, set by cache_select_kernels
+  Flag (*access_fn)(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+  void (*install_fn)(Cache *c, Addr lineaddr, uns mark_dirty);
+  void (*fill_fn)(Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+  Flag   specialized;       // a fixed-geometry kernel was picked
+  Flag   last_tag_hit;      // the latest access found the tag (hit or sector miss)
   Cache_Line last_evicted_line; // for checking writebacks
+  Cache_Line *last_touched_line; // line hit or installed by the latest access/install
+
+  // sectored lines: one tag, per-sector valid/dirty bits
+  uns64  sectors_per_line;
+  uns64  sector_all;        // mask with every sector of a line set
+  uns64  last_missing_sectors; // requested sectors the latest access missed
+
+  // compressed cache: up to 2x the tags, lines share a byte budget
+  uns64  comp_budget;       // bytes per set, 0 if uncompressed
+  uns64  comp_base_ways;    // associativity the budget was sized for
+  uns64  comp_resident;     // valid lines in the whole cache
+  uns64  comp_num_evicted;
+  Cache_Line comp_evicted[MAX_WAYS]; // lines replaced by the latest install
+
+  // way prediction (the predicted way is also probed first when off)
+  uns64  way_pred;
+  uns64  waypred_latency;   // hit latency when the predicted way hits
+  uns64  waypred_penalty;   // extra cycles when it does not
+  uns8  *waypred_table;     // WAYPRED_PC: predicted way per PC hash
+  Addr  *cur_pc;            // PC of the access, owned by memsys
+  Flag   waypred_correct;   // outcome of the latest lookup
+
+  // insertion position of new lines (LRU replacement only)
+  uns64  insert_policy;
+  uns64  bip_throttle;      // INSERT_BIP: 1 in this many fills at MRU
+  uns64  bip_count;
+  Flag   insert_dead;       // INSERT_PRED: the next install goes to LRU
 
   //stats
   uns64 stat_read_access; 
@@ -41,6 +121,16 @@ struct Cache{
   uns64 stat_read_miss; 
   uns64 stat_write_miss; 
   uns64 stat_dirty_evicts; // how many dirty lines were evicted?
+  uns64 stat_tag_reads;    // dynamic energy: tag array ways read
+  uns64 stat_data_reads;   // dynamic energy: data array ways read
+  uns64 stat_data_writes;  // dynamic energy: write hits and fills
+  uns64 stat_waypred_correct;
+  uns64 stat_waypred_wrong;
+  uns64 stat_sector_miss;   // tag hit, but a requested sector not present
+  uns64 stat_evict_lines;   // valid lines replaced
+  uns64 stat_evict_sectors; // valid sectors in them (utilization)
+  uns64 stat_resident_sum;  // compressed: valid lines summed over accesses
+  uns64 stat_resident_samples;
 };
 
 
@@ -50,7 +140,25 @@ struct Cache{
 Cache  *cache_new(uns64 size, uns64 assocs, uns64 linesize, uns64 repl_policy);
 Flag    cache_access         (Cache *c, Addr lineaddr, uns mark_dirty);
 void    cache_install        (Cache *c, Addr lineaddr, uns mark_dirty);
+Flag    cache_access_sectors (Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+void    cache_fill           (Cache *c, Addr lineaddr, uns64 mask, uns mark_dirty);
+void    cache_set_sectors    (Cache *c, uns64 sectors_per_line);
+void    cache_print_sector_stats (Cache *c, char *header);
+void    cache_set_index_policy (Cache *c, uns64 policy);
+void    cache_set_insertion  (Cache *c, uns64 policy, uns64 bip_throttle);
+void    cache_alloc_sets     (Cache *c, uns64 policy);
+void    cache_select_kernels (Cache *c, Flag specialize);
+void    cache_enable_set_stats (Cache *c);
+void    cache_print_set_stats (Cache *c, char *header);
+void    cache_enable_compression (Cache *c, uns64 linesize);
+void    cache_install_compressed (Cache *c, Addr lineaddr, uns mark_dirty, uns size);
+void    cache_print_compress_stats (Cache *c, char *header);
+void    cache_touch_line     (Cache *c, Cache_Line *line);
 void    cache_print_stats    (Cache *c, char *header);
+void    cache_register_stats (Cache *c, char *header);
+void    cache_print_lookup_stats (Cache *c, char *header);
+void    cache_enable_waypred (Cache *c, uns64 policy, uns64 latency, uns64 penalty, Addr *cur_pc);
+uns64   cache_lookup_latency (Cache *c, uns64 hit_latency);
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
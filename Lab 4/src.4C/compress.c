@@ -0,0 +1,183 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+#include "hash.h"
+#include "stats.h"
+
+void die_message(const char * msg);
+
+//////////////////////////////////////////////////////////////////
+// Synthetic encodings, sizes in eighths of a line. Weights (in %)
+// roughly follow the BDI/FPC results for SPEC integer workloads.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Compress_Class {
+  uns eighths;
+  uns weight;
+} Compress_Class;
+
+static const Compress_Class compress_classes[] = {
+  {1, 15},  // zero / repeated value
+  {2, 10},  // base8-delta1
+  {3, 10},  // base8-delta2, base4-delta1
+  {4, 10},  // base2-delta1, FPC narrow words
+  {5, 15},  // base8-delta4, base4-delta2
+  {8, 40},  // incompressible
+};
+
+#define NUM_COMPRESS_CLASSES (sizeof(compress_classes)/sizeof(compress_classes[0]))
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static Compress_Entry *compress_probe(Compress *cp, Addr lineaddr){
+  uns64 mask = cp->num_entries - 1;
+  uns64 idx = hash_mix(lineaddr) & mask;
+
+  while(cp->map[idx].valid && cp->map[idx].lineaddr != lineaddr){
+    idx = (idx + 1) & mask;
+  }
+  return &cp->map[idx];
+}
+
+static void compress_map_insert(Compress *cp, Addr lineaddr, uns size){
+  Compress_Entry *e;
+
+  if(2*(cp->used_entries+1) > cp->num_entries){
+    Compress_Entry *old = cp->map;
+    uns64 old_num = cp->num_entries, ii;
+
+    cp->num_entries = old_num ? 2*old_num : COMPRESS_INIT_ENTRIES;
+    cp->map = (Compress_Entry *) calloc (cp->num_entries, sizeof(Compress_Entry));
+    for(ii=0; ii<old_num; ii++){
+      if(old[ii].valid){
+        *compress_probe(cp, old[ii].lineaddr) = old[ii];
+      }
+    }
+    free(old);
+  }
+
+  e = compress_probe(cp, lineaddr);
+  if(!e->valid){
+    e->valid = TRUE;
+    e->lineaddr = lineaddr;
+    cp->used_entries++;
+  }
+  e->size = size;
+}
+
+static void compress_load_map(Compress *cp, const char *filename){
+  FILE *fp;
+  char  line[256];
+  char  msg[1024];
+  uns   lineno=0;
+
+  if((fp = fopen(filename, "r")) == NULL){
+    sprintf(msg, "Unable to open compression map %.900s", filename);
+    die_message(msg);
+  }
+
+  while(fgets(line, sizeof(line), fp)){
+    unsigned long long addr, size;
+
+    lineno++;
+    if(line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0'){
+      continue;
+    }
+    if(sscanf(line, "%lli %lli", &addr, &size) != 2 || size == 0 || size > cp->linesize){
+      sprintf(msg, "%.900s:%u: expected <address> <size 1..linesize>", filename, lineno);
+      die_message(msg);
+    }
+    compress_map_insert(cp, addr/cp->linesize, size);
+  }
+
+  fclose(fp);
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Compress *compress_new(uns64 linesize, const char *map_filename){
+  Compress *cp = (Compress *) calloc (1, sizeof (Compress));
+
+  cp->linesize = linesize;
+  if(map_filename){
+    compress_load_map(cp, map_filename);
+  }
+
+  return cp;
+}
+
+//////////////////////////////////////////////////////////////////
+// Compressed size in bytes, rounded up to whole segments
+//////////////////////////////////////////////////////////////////
+
+uns compress_line_size(Compress *cp, Addr lineaddr){
+  uns64 size = 0;
+  uns   bucket;
+
+  if(cp->map){
+    Compress_Entry *e = compress_probe(cp, lineaddr);
+    if(e->valid){
+      size = e->size;
+      cp->stat_map_hits++;
+    }
+  }
+
+  if(!size){
+    uns pick = hash_mix(lineaddr) % 100;
+    uns ii;
+
+    for(ii=0; ii<NUM_COMPRESS_CLASSES-1 && pick >= compress_classes[ii].weight; ii++){
+      pick -= compress_classes[ii].weight;
+    }
+    size = compress_classes[ii].eighths * cp->linesize / 8;
+  }
+
+  size = (size + COMPRESS_SEGMENT - 1) / COMPRESS_SEGMENT * COMPRESS_SEGMENT;
+  if(size > cp->linesize){
+    size = cp->linesize;
+  }
+
+  bucket = (size * COMPRESS_HIST_BUCKETS + cp->linesize - 1) / cp->linesize;
+  cp->stat_lines++;
+  cp->stat_bytes += size;
+  cp->stat_size_hist[bucket]++;
+
+  return size;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void compress_register_stats(Compress *cp){
+  stats_register("COMPRESS", "LINES",    &cp->stat_lines);
+  stats_register("COMPRESS", "BYTES",    &cp->stat_bytes);
+  stats_register("COMPRESS", "MAP_HITS", &cp->stat_map_hits);
+  stats_register("COMPRESS", "DECOMPRESS", &cp->stat_decompress);
+}
+
+void compress_print(Compress *cp){
+  char   header[256];
+  double ratio = 0;
+  uns    ii;
+
+  sprintf(header, "COMPRESS");
+
+  if(cp->stat_bytes){
+    ratio = (double)(cp->stat_lines * cp->linesize) / (double)(cp->stat_bytes);
+  }
+
+  printf("\n");
+  printf("\n%s_LINES          \t\t : %10llu", header, cp->stat_lines);
+  printf("\n%s_MAP_HITS       \t\t : %10llu", header, cp->stat_map_hits);
+  printf("\n%s_DECOMPRESS     \t\t : %10llu", header, cp->stat_decompress);
+  printf("\n%s_RATIO          \t\t : %10.3f", header, ratio);
+  for(ii=1; ii<=COMPRESS_HIST_BUCKETS; ii++){
+    printf("\n%s_SIZE_%u_8THS   \t\t : %10llu", header, ii, cp->stat_size_hist[ii]);
+  }
+  printf("\n");
+}
@@ -0,0 +1,58 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "types.h"
+
+#define COMPRESS_SEGMENT       8    // compressed sizes are whole segments (bytes)
+#define COMPRESS_INIT_ENTRIES  4096 // initial size map hash size (power of two)
+#define COMPRESS_HIST_BUCKETS  8    // size histogram in eighths of a line
+
+//////////////////////////////////////////////////////////////////
+// Compressed size of each cache line for the compressed L2.
+//
+// The trace carries addresses only, so by default the size comes
+// from a synthetic BDI/FPC-style distribution: every line address
+// is hashed to an encoding (zero, base+delta, ..., uncompressed)
+// picked with fixed weights, so a line always gets the same size.
+//
+// -compmap <file> supplies measured sizes from a value-aware tool,
+// one "<byte address> <compressed bytes>" pair per text line.
+// Lines not in the map fall back to the synthetic distribution.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Compress_Entry Compress_Entry;
+typedef struct Compress Compress;
+
+
+struct Compress_Entry {
+  Flag   valid;
+  Addr   lineaddr;
+  uns    size;
+};
+
+
+struct Compress {
+  uns64           linesize;
+
+  Compress_Entry *map;          // sizes from -compmap, NULL if none
+  uns64           num_entries;  // capacity, power of two
+  uns64           used_entries;
+
+  // stats, per line installed in the compressed cache
+  uns64           stat_lines;
+  uns64           stat_bytes;
+  uns64           stat_map_hits;
+  uns64           stat_decompress; // L2 hits on a compressed line
+  uns64           stat_size_hist[COMPRESS_HIST_BUCKETS+1];
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Compress *compress_new(uns64 linesize, const char *map_filename);
+uns       compress_line_size(Compress *cp, Addr lineaddr);
+void      compress_register_stats(Compress *cp);
+void      compress_print(Compress *cp);
+
+#endif // COMPRESS_H
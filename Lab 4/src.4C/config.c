@@ -0,0 +1,619 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "config.h"
+#include "cache.h"
+#include "dram.h"
+#include "wcb.h"
+#include "dramcache.h"
+#include "tracegen.h"
+
+extern MODE   SIM_MODE;
+extern uns64  CACHE_LINESIZE;
+extern uns64  REPL_POLICY;
+extern uns64  SECTOR_SIZE;
+extern uns64  CACHE_SET_ALLOC;
+
+extern uns64  DCACHE_SIZE;
+extern uns64  DCACHE_ASSOC;
+extern uns64  DCACHE_LINESIZE;
+extern uns64  DCACHE_HIT_LATENCY;
+extern uns64  ICACHE_SIZE;
+extern uns64  ICACHE_ASSOC;
+extern uns64  ICACHE_LINESIZE;
+extern uns64  ICACHE_HIT_LATENCY;
+extern uns64  L2CACHE_SIZE;
+extern uns64  L2CACHE_ASSOC;
+extern uns64  L2CACHE_LINESIZE;
+extern uns64  L2CACHE_HIT_LATENCY;
+extern uns64  L2CACHE_COMPRESS;
+extern uns64  DCACHE_WRITE_POLICY;
+extern uns64  DCACHE_WRITE_MISS;
+extern uns64  L2CACHE_WRITE_POLICY;
+extern uns64  L2CACHE_WRITE_MISS;
+extern uns64  WCB_ENTRIES;
+extern uns64  L2CACHE_INSERT;
+extern uns64  L2CACHE_BYPASS;
+extern uns64  BIP_THROTTLE;
+extern uns64  REUSE_ENTRIES;
+extern uns64  DCACHE_INDEX;
+extern uns64  ICACHE_INDEX;
+extern uns64  L2CACHE_INDEX;
+extern uns64  SET_STATS;
+extern uns64  FETCHBUF_STATS;
+extern uns64  L2CACHE_DECOMP_LATENCY;
+
+extern uns64  DCACHE_WAYPRED;
+extern uns64  DCACHE_WAYPRED_LATENCY;
+extern uns64  DCACHE_WAYPRED_PENALTY;
+extern uns64  ICACHE_WAYPRED;
+extern uns64  ICACHE_WAYPRED_LATENCY;
+extern uns64  ICACHE_WAYPRED_PENALTY;
+extern uns64  L2CACHE_WAYPRED;
+extern uns64  L2CACHE_WAYPRED_LATENCY;
+extern uns64  L2CACHE_WAYPRED_PENALTY;
+
+extern uns64  DCACHE_E_TAG;
+extern uns64  DCACHE_E_READ;
+extern uns64  DCACHE_E_WRITE;
+extern uns64  DCACHE_E_STATIC;
+extern uns64  ICACHE_E_TAG;
+extern uns64  ICACHE_E_READ;
+extern uns64  ICACHE_E_WRITE;
+extern uns64  ICACHE_E_STATIC;
+extern uns64  L2CACHE_E_TAG;
+extern uns64  L2CACHE_E_READ;
+extern uns64  L2CACHE_E_WRITE;
+extern uns64  L2CACHE_E_STATIC;
+extern uns64  DRAM_E_ACT;
+extern uns64  DRAM_E_PRE;
+extern uns64  DRAM_E_RD_BURST;
+extern uns64  DRAM_E_WR_BURST;
+extern uns64  DRAM_E_BACKGROUND;
+
+extern uns64  DRAM_BANKS;
+extern uns64  ROWBUF_SIZE;
+extern uns64  DRAM_LATENCY_FIXED;
+extern uns64  DRAM_T_ACT;
+extern uns64  DRAM_T_CAS;
+extern uns64  DRAM_T_PRE;
+extern uns64  DRAM_T_BUS;
+extern uns64  DRAM_T_REFI;
+extern uns64  DRAM_T_RFC;
+extern uns64  DRAM_T_RRD;
+extern uns64  DRAM_T_FAW;
+extern uns64  DRAM_PD_THRESHOLD;
+extern uns64  DRAM_T_XP;
+extern uns64  DRAM_ROW_POLICY;
+extern uns64  DRAM_ROW_TIMEOUT;
+extern uns64  DRAM_BANK_STATS;
+extern uns64  DRAM_E_PD_BACKGROUND;
+
+extern uns64  DRAMCACHE_ORG;
+extern uns64  DRAMCACHE_SIZE;
+extern uns64  DRAMCACHE_ASSOC;
+extern uns64  DRAMCACHE_PAGE_SIZE;
+extern uns64  DRAMCACHE_LATENCY;
+extern uns64  DRAMCACHE_TAG_LATENCY;
+extern uns64  DRAMCACHE_CHANNELS;
+extern uns64  DRAMCACHE_T_BURST;
+extern uns64  DRAMCACHE_PREDICT;
+extern uns64  DRAMCACHE_MAP_ENTRIES;
+extern uns64  DRAMCACHE_FHT_ENTRIES;
+extern uns64  DRAMCACHE_E_BURST;
+
+extern uns64  TRACE64;
+extern uns64  CORE_OOO;
+extern uns64  ROB_SIZE;
+extern uns64  CORE_WIDTH;
+extern uns64  LQ_SIZE;
+extern uns64  SQ_SIZE;
+extern uns64  CORE_MSHRS;
+
+extern uns64  TLB_ENABLE;
+extern uns64  ITLB_ENTRIES;
+extern uns64  ITLB_ASSOC;
+extern uns64  DTLB_ENTRIES;
+extern uns64  DTLB_ASSOC;
+extern uns64  STLB_ENTRIES;
+extern uns64  STLB_ASSOC;
+extern uns64  STLB_LATENCY;
+extern uns64  HUGEPAGE_PCT;
+
+extern uns64  SYNTH_INSTS;
+extern uns64  SYNTH_SEED;
+extern uns64  SYNTH_MEM_PCT;
+extern uns64  SYNTH_STORE_PCT;
+extern uns64  SYNTH_STREAM_PCT;
+extern uns64  SYNTH_CHASE_PCT;
+extern uns64  SYNTH_ZIPF_PCT;
+extern uns64  SYNTH_STREAM_SIZE;
+extern uns64  SYNTH_STRIDE;
+extern uns64  SYNTH_CHASE_SIZE;
+extern uns64  SYNTH_ZIPF_SIZE;
+extern uns64  SYNTH_ZIPF_THETA;
+extern uns64  SYNTH_CODE_SIZE;
+
+extern uns64  PROFILE_TOPN;
+extern uns64  PROFILE_REGION;
+
+void die_message(const char * msg);
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+typedef struct Config_Param {
+  const char *section;
+  const char *key;
+  uns64      *var;
+  uns64       scale; // value in file is multiplied by this (KB -> bytes)
+} Config_Param;
+
+static uns64 config_mode;
+
+static Config_Param config_params[] = {
+  {"sim",     "mode",          &config_mode,         1},
+  {"sim",     "linesize",      &CACHE_LINESIZE,      1},
+  {"sim",     "repl",          &REPL_POLICY,         1},
+  {"sim",     "sector_size",   &SECTOR_SIZE,         1},
+  {"sim",     "trace64",       &TRACE64,             1},
+  {"sim",     "set_stats",     &SET_STATS,           1},
+  {"sim",     "fetchbuf_stats", &FETCHBUF_STATS,     1},
+  {"sim",     "wcb_entries",   &WCB_ENTRIES,         1},
+  {"sim",     "set_alloc",     &CACHE_SET_ALLOC,     1},
+
+  {"dcache",  "size_kb",       &DCACHE_SIZE,         1024},
+  {"dcache",  "assoc",         &DCACHE_ASSOC,        1},
+  {"dcache",  "linesize",      &DCACHE_LINESIZE,     1},
+  {"dcache",  "hit_latency",   &DCACHE_HIT_LATENCY,  1},
+  {"dcache",  "index",         &DCACHE_INDEX,        1},
+  {"dcache",  "write_policy",  &DCACHE_WRITE_POLICY, 1},
+  {"dcache",  "write_miss",    &DCACHE_WRITE_MISS,   1},
+  {"dcache",  "waypred",         &DCACHE_WAYPRED,          1},
+  {"dcache",  "waypred_latency", &DCACHE_WAYPRED_LATENCY,  1},
+  {"dcache",  "waypred_penalty", &DCACHE_WAYPRED_PENALTY,  1},
+  {"dcache",  "e_tag",           &DCACHE_E_TAG,            1},
+  {"dcache",  "e_read",          &DCACHE_E_READ,           1},
+  {"dcache",  "e_write",         &DCACHE_E_WRITE,          1},
+  {"dcache",  "e_static",        &DCACHE_E_STATIC,         1},
+
+  {"icache",  "size_kb",       &ICACHE_SIZE,         1024},
+  {"icache",  "assoc",         &ICACHE_ASSOC,        1},
+  {"icache",  "linesize",      &ICACHE_LINESIZE,     1},
+  {"icache",  "hit_latency",   &ICACHE_HIT_LATENCY,  1},
+  {"icache",  "index",         &ICACHE_INDEX,        1},
+  {"icache",  "waypred",         &ICACHE_WAYPRED,          1},
+  {"icache",  "waypred_latency", &ICACHE_WAYPRED_LATENCY,  1},
+  {"icache",  "waypred_penalty", &ICACHE_WAYPRED_PENALTY,  1},
+  {"icache",  "e_tag",           &ICACHE_E_TAG,            1},
+  {"icache",  "e_read",          &ICACHE_E_READ,           1},
+  {"icache",  "e_write",         &ICACHE_E_WRITE,          1},
+  {"icache",  "e_static",        &ICACHE_E_STATIC,         1},
+
+  {"l2cache", "size_kb",       &L2CACHE_SIZE,        1024},
+  {"l2cache", "assoc",         &L2CACHE_ASSOC,       1},
+  {"l2cache", "linesize",      &L2CACHE_LINESIZE,    1},
+  {"l2cache", "hit_latency",   &L2CACHE_HIT_LATENCY, 1},
+  {"l2cache", "index",         &L2CACHE_INDEX,       1},
+  {"l2cache", "write_policy",  &L2CACHE_WRITE_POLICY, 1},
+  {"l2cache", "write_miss",    &L2CACHE_WRITE_MISS,  1},
+  {"l2cache", "insert",        &L2CACHE_INSERT,      1},
+  {"l2cache", "bypass",        &L2CACHE_BYPASS,      1},
+  {"l2cache", "bip_throttle",  &BIP_THROTTLE,        1},
+  {"l2cache", "reuse_entries", &REUSE_ENTRIES,       1},
+  {"l2cache", "waypred",         &L2CACHE_WAYPRED,         1},
+  {"l2cache", "waypred_latency", &L2CACHE_WAYPRED_LATENCY, 1},
+  {"l2cache", "waypred_penalty", &L2CACHE_WAYPRED_PENALTY, 1},
+  {"l2cache", "compress",        &L2CACHE_COMPRESS,        1},
+  {"l2cache", "decomp_latency",  &L2CACHE_DECOMP_LATENCY,  1},
+  {"l2cache", "e_tag",           &L2CACHE_E_TAG,            1},
+  {"l2cache", "e_read",          &L2CACHE_E_READ,           1},
+  {"l2cache", "e_write",         &L2CACHE_E_WRITE,          1},
+  {"l2cache", "e_static",        &L2CACHE_E_STATIC,         1},
+
+  {"core",    "ooo",           &CORE_OOO,            1},
+  {"core",    "rob_size",      &ROB_SIZE,            1},
+  {"core",    "width",         &CORE_WIDTH,          1},
+  {"core",    "lq_size",       &LQ_SIZE,             1},
+  {"core",    "sq_size",       &SQ_SIZE,             1},
+  {"core",    "mshrs",         &CORE_MSHRS,          1},
+
+  {"tlb",     "enable",        &TLB_ENABLE,          1},
+  {"tlb",     "itlb_entries",  &ITLB_ENTRIES,        1},
+  {"tlb",     "itlb_assoc",    &ITLB_ASSOC,          1},
+  {"tlb",     "dtlb_entries",  &DTLB_ENTRIES,        1},
+  {"tlb",     "dtlb_assoc",    &DTLB_ASSOC,          1},
+  {"tlb",     "stlb_entries",  &STLB_ENTRIES,        1},
+  {"tlb",     "stlb_assoc",    &STLB_ASSOC,          1},
+  {"tlb",     "stlb_latency",  &STLB_LATENCY,        1},
+  {"tlb",     "hugepage_pct",  &HUGEPAGE_PCT,        1},
+
+  {"dram",    "banks",         &DRAM_BANKS,          1},
+  {"dram",    "rowbuf_size",   &ROWBUF_SIZE,         1},
+  {"dram",    "latency_fixed", &DRAM_LATENCY_FIXED,  1},
+  {"dram",    "t_act",         &DRAM_T_ACT,          1},
+  {"dram",    "t_cas",         &DRAM_T_CAS,          1},
+  {"dram",    "t_pre",         &DRAM_T_PRE,          1},
+  {"dram",    "t_bus",         &DRAM_T_BUS,          1},
+  {"dram",    "t_refi",        &DRAM_T_REFI,         1},
+  {"dram",    "t_rfc",         &DRAM_T_RFC,          1},
+  {"dram",    "t_rrd",         &DRAM_T_RRD,          1},
+  {"dram",    "t_faw",         &DRAM_T_FAW,          1},
+  {"dram",    "pd_threshold",  &DRAM_PD_THRESHOLD,   1},
+  {"dram",    "t_xp",          &DRAM_T_XP,           1},
+  {"dram",    "row_policy",    &DRAM_ROW_POLICY,     1},
+  {"dram",    "row_timeout",   &DRAM_ROW_TIMEOUT,    1},
+  {"dram",    "bank_stats",    &DRAM_BANK_STATS,     1},
+  {"dram",    "e_act",         &DRAM_E_ACT,          1},
+  {"dram",    "e_pre",         &DRAM_E_PRE,          1},
+  {"dram",    "e_rd_burst",    &DRAM_E_RD_BURST,     1},
+  {"dram",    "e_wr_burst",    &DRAM_E_WR_BURST,     1},
+  {"dram",    "e_background",  &DRAM_E_BACKGROUND,   1},
+  {"dram",    "e_pd_background", &DRAM_E_PD_BACKGROUND, 1},
+
+  {"dramcache", "org",         &DRAMCACHE_ORG,         1},
+  {"dramcache", "size_mb",     &DRAMCACHE_SIZE,        1024*1024},
+  {"dramcache", "assoc",       &DRAMCACHE_ASSOC,       1},
+  {"dramcache", "page_size",   &DRAMCACHE_PAGE_SIZE,   1},
+  {"dramcache", "latency",     &DRAMCACHE_LATENCY,     1},
+  {"dramcache", "tag_latency", &DRAMCACHE_TAG_LATENCY, 1},
+  {"dramcache", "channels",    &DRAMCACHE_CHANNELS,    1},
+  {"dramcache", "t_burst",     &DRAMCACHE_T_BURST,     1},
+  {"dramcache", "predict",     &DRAMCACHE_PREDICT,     1},
+  {"dramcache", "map_entries", &DRAMCACHE_MAP_ENTRIES, 1},
+  {"dramcache", "fht_entries", &DRAMCACHE_FHT_ENTRIES, 1},
+  {"dramcache", "e_burst",     &DRAMCACHE_E_BURST,     1},
+
+  {"synth",   "insts",         &SYNTH_INSTS,         1},
+  {"synth",   "seed",          &SYNTH_SEED,          1},
+  {"synth",   "mem_pct",       &SYNTH_MEM_PCT,       1},
+  {"synth",   "store_pct",     &SYNTH_STORE_PCT,     1},
+  {"synth",   "stream_pct",    &SYNTH_STREAM_PCT,    1},
+  {"synth",   "chase_pct",     &SYNTH_CHASE_PCT,     1},
+  {"synth",   "zipf_pct",      &SYNTH_ZIPF_PCT,      1},
+  {"synth",   "stream_kb",     &SYNTH_STREAM_SIZE,   1024},
+  {"synth",   "stride",        &SYNTH_STRIDE,        1},
+  {"synth",   "chase_kb",      &SYNTH_CHASE_SIZE,    1024},
+  {"synth",   "zipf_kb",       &SYNTH_ZIPF_SIZE,     1024},
+  {"synth",   "zipf_theta",    &SYNTH_ZIPF_THETA,    1},
+  {"synth",   "code_kb",       &SYNTH_CODE_SIZE,     1024},
+};
+
+#define NUM_CONFIG_PARAMS (sizeof(config_params)/sizeof(config_params[0]))
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static char *config_trim(char *str){
+  char *end;
+
+  while(isspace((unsigned char)*str)){
+    str++;
+  }
+
+  end = str + strlen(str);
+  while(end > str && isspace((unsigned char)end[-1])){
+    end--;
+  }
+  *end = '\0';
+
+  return str;
+}
+
+//////////////////////////////////////////////////////////////////
+// Read the file and set every parameter it names
+//////////////////////////////////////////////////////////////////
+
+void config_load(const char *filename){
+  FILE *fp;
+  char  line[1024];
+  char  section[64]="";
+  char  msg[1024];
+  uns   lineno=0;
+  uns   ii;
+
+  if((fp = fopen(filename, "r")) == NULL){
+    sprintf(msg, "Unable to open config file %.900s", filename);
+    die_message(msg);
+  }
+
+  config_mode = SIM_MODE;
+
+  while(fgets(line, sizeof(line), fp)){
+    char *str, *key, *val, *endp;
+    uns64 value;
+    Flag  found=FALSE;
+
+    lineno++;
+    str = strpbrk(line, "#;");
+    if(str){
+      *str = '\0';
+    }
+    str = config_trim(line);
+
+    if(*str == '\0'){
+      continue;
+    }
+
+    if(*str == '['){
+      char *close = strchr(str, ']');
+      if(!close || close[1] != '\0' || close - str - 1 >= (int) sizeof(section)){
+	sprintf(msg, "%.900s:%u: bad section header", filename, lineno);
+	die_message(msg);
+      }
+      *close = '\0';
+      strcpy(section, config_trim(str+1));
+      continue;
+    }
+
+    val = strchr(str, '=');
+    if(!val){
+      sprintf(msg, "%.900s:%u: expected key = value", filename, lineno);
+      die_message(msg);
+    }
+    *val = '\0';
+    key = config_trim(str);
+    val = config_trim(val+1);
+
+    value = strtoull(val, &endp, 0);
+    if(*val == '\0' || *val == '-' || *endp != '\0'){
+      sprintf(msg, "%.900s:%u: value of %.32s is not an unsigned integer", filename, lineno, key);
+      die_message(msg);
+    }
+
+    for(ii=0; ii<NUM_CONFIG_PARAMS; ii++){
+      if(!strcmp(section, config_params[ii].section) && !strcmp(key, config_params[ii].key)){
+	*config_params[ii].var = value * config_params[ii].scale;
+	found = TRUE;
+	break;
+      }
+    }
+
+    if(!found){
+      sprintf(msg, "%.900s:%u: unknown parameter [%s] %.32s", filename, lineno, section, key);
+      die_message(msg);
+    }
+  }
+
+  fclose(fp);
+  SIM_MODE = config_mode;
+}
+
+//////////////////////////////////////////////////////////////////
+// Check the final parameters (file + command line) for consistency
+//////////////////////////////////////////////////////////////////
+
+static uns64 config_is_pow2(uns64 value){
+  return value && !(value & (value-1));
+}
+
+static void config_validate_cache(const char *name, uns64 size, uns64 assoc, uns64 linesize){
+  char msg[256];
+
+  if(assoc < 1 || assoc > MAX_WAYS){
+    sprintf(msg, "%s assoc must be between 1 and %d", name, MAX_WAYS);
+    die_message(msg);
+  }
+
+  if(!config_is_pow2(linesize)){
+    sprintf(msg, "%s linesize must be a power of two", name);
+    die_message(msg);
+  }
+
+  if(SECTOR_SIZE && (SECTOR_SIZE > linesize || linesize/SECTOR_SIZE > MAX_SECTORS)){
+    sprintf(msg, "sector_size must be no larger than the %s linesize, with at most %d sectors per line", name, MAX_SECTORS);
+    die_message(msg);
+  }
+
+  if(size == 0 || size % (linesize*assoc)){
+    sprintf(msg, "%s size must be a multiple of linesize*assoc", name);
+    die_message(msg);
+  }
+
+  if(!config_is_pow2(size/(linesize*assoc))){
+    sprintf(msg, "%s number of sets must be a power of two", name);
+    die_message(msg);
+  }
+}
+
+static void config_validate_tlb(const char *name, uns64 entries, uns64 assoc){
+  char msg[256];
+
+  if(assoc < 1 || entries % assoc || !entries){
+    sprintf(msg, "%s entries must be a non-zero multiple of assoc", name);
+    die_message(msg);
+  }
+}
+
+void config_validate(void){
+  char msg[256];
+
+  if(SIM_MODE < SIM_MODE_A || SIM_MODE > SIM_MODE_C){
+    die_message("mode must be 1, 2 or 3");
+  }
+
+  if(!config_is_pow2(CACHE_LINESIZE)){
+    die_message("linesize must be a power of two");
+  }
+
+  // per-level line sizes default to linesize
+  if(!DCACHE_LINESIZE){
+    DCACHE_LINESIZE = CACHE_LINESIZE;
+  }
+  if(!ICACHE_LINESIZE){
+    ICACHE_LINESIZE = CACHE_LINESIZE;
+  }
+  if(!L2CACHE_LINESIZE){
+    L2CACHE_LINESIZE = CACHE_LINESIZE;
+  }
+
+  if(SECTOR_SIZE && !config_is_pow2(SECTOR_SIZE)){
+    die_message("sector_size must be a power of two");
+  }
+
+  if(REPL_POLICY > 1){
+    die_message("repl must be 0 (LRU) or 1 (RAND)");
+  }
+
+  if(DCACHE_WAYPRED > WAYPRED_PC || ICACHE_WAYPRED > WAYPRED_PC || L2CACHE_WAYPRED > WAYPRED_PC){
+    die_message("waypred must be 0 (none), 1 (MRU) or 2 (PC)");
+  }
+
+  if(DCACHE_INDEX > INDEX_SKEW || ICACHE_INDEX > INDEX_SKEW || L2CACHE_INDEX > INDEX_SKEW){
+    die_message("index must be 0 (modulo), 1 (XOR), 2 (prime) or 3 (skewed)");
+  }
+
+  if(DCACHE_WRITE_POLICY > WRITE_THROUGH || L2CACHE_WRITE_POLICY > WRITE_THROUGH){
+    die_message("write_policy must be 0 (write-back) or 1 (write-through)");
+  }
+
+  if(DCACHE_WRITE_MISS > WRITE_COMBINE || L2CACHE_WRITE_MISS > WRITE_COMBINE){
+    die_message("write_miss must be 0 (allocate), 1 (no-allocate) or 2 (combining buffer)");
+  }
+
+  if(!WCB_ENTRIES){
+    die_message("wcb_entries must be at least 1");
+  }
+
+  if(CACHE_SET_ALLOC > SET_ALLOC_HUGE){
+    die_message("set_alloc must be 0 (calloc), 1 (lazy) or 2 (huge pages)");
+  }
+
+  if(SIM_MODE == SIM_MODE_A && (DCACHE_WRITE_POLICY || DCACHE_WRITE_MISS)){
+    die_message("DCACHE write policies need mode 2 or 3 (Part A has no next level)");
+  }
+
+  if(L2CACHE_INSERT > INSERT_PRED){
+    die_message("L2 insert must be 0 (MRU), 1 (LIP), 2 (BIP) or 3 (PC reuse predictor)");
+  }
+
+  if(L2CACHE_BYPASS > 1){
+    die_message("L2 bypass must be 0 (off) or 1 (on)");
+  }
+
+  if(!BIP_THROTTLE){
+    die_message("bip_throttle must be at least 1");
+  }
+
+  if(!config_is_pow2(REUSE_ENTRIES) || REUSE_ENTRIES > (1ULL<<24)){
+    die_message("reuse_entries must be a power of two, at most 16M");
+  }
+
+  if(L2CACHE_COMPRESS && (L2CACHE_INSERT || L2CACHE_BYPASS)){
+    die_message("compressed L2 does not support insertion policies or bypass");
+  }
+
+  if(L2CACHE_COMPRESS && L2CACHE_INDEX == INDEX_SKEW){
+    die_message("compressed L2 does not support skewed indexing");
+  }
+
+  if(L2CACHE_COMPRESS > 1){
+    die_message("L2 compress must be 0 (off) or 1 (on)");
+  }
+
+  if(L2CACHE_COMPRESS && SECTOR_SIZE && SECTOR_SIZE != L2CACHE_LINESIZE){
+    die_message("compressed L2 does not support sectored lines");
+  }
+
+  config_validate_cache("DCACHE", DCACHE_SIZE, DCACHE_ASSOC, DCACHE_LINESIZE);
+
+  if(SIM_MODE != SIM_MODE_A){
+    config_validate_cache("ICACHE", ICACHE_SIZE, ICACHE_ASSOC, ICACHE_LINESIZE);
+    config_validate_cache("L2CACHE", L2CACHE_SIZE, L2CACHE_ASSOC, L2CACHE_LINESIZE);
+    if(L2CACHE_LINESIZE < DCACHE_LINESIZE || L2CACHE_LINESIZE < ICACHE_LINESIZE){
+      die_message("L2 linesize must be at least the DCACHE and ICACHE linesize");
+    }
+  }
+
+  if(CORE_OOO && (!ROB_SIZE || !CORE_WIDTH || !LQ_SIZE || !SQ_SIZE)){
+    die_message("rob, width, lq and sq must be non-zero");
+  }
+
+  if(TLB_ENABLE){
+    if(SIM_MODE == SIM_MODE_A){
+      die_message("tlb needs mode 2 or 3 (the page walker reads through the L2)");
+    }
+    config_validate_tlb("ITLB", ITLB_ENTRIES, ITLB_ASSOC);
+    config_validate_tlb("DTLB", DTLB_ENTRIES, DTLB_ASSOC);
+    config_validate_tlb("STLB", STLB_ENTRIES, STLB_ASSOC);
+    if(HUGEPAGE_PCT > 100){
+      die_message("hugepages must be a percentage (0 to 100)");
+    }
+  }
+
+  if(DRAM_BANKS < 1 || DRAM_BANKS > MAX_DRAM_BANKS){
+    sprintf(msg, "DRAM banks must be between 1 and %d", MAX_DRAM_BANKS);
+    die_message(msg);
+  }
+
+  if(DRAM_ROW_POLICY > ROW_PREDICT){
+    die_message("DRAM row_policy must be 0 (open), 1 (closed), 2 (timeout) or 3 (predictive)");
+  }
+
+  if(DRAM_T_REFI && DRAM_T_RFC >= DRAM_T_REFI){
+    die_message("DRAM t_rfc must be less than t_refi");
+  }
+
+  if(ROWBUF_SIZE < L2CACHE_LINESIZE || ROWBUF_SIZE % L2CACHE_LINESIZE){
+    die_message("DRAM rowbuf_size must be a multiple of the L2 linesize");
+  }
+
+  if(DRAMCACHE_ORG > DRAMCACHE_FOOTPRINT){
+    die_message("dramcache must be 0 (off), 1 (Alloy) or 2 (Footprint)");
+  }
+
+  if(DRAMCACHE_ORG){
+    uns64 page = (DRAMCACHE_ORG == DRAMCACHE_FOOTPRINT) ? DRAMCACHE_PAGE_SIZE : L2CACHE_LINESIZE;
+    uns64 ways = (DRAMCACHE_ORG == DRAMCACHE_FOOTPRINT) ? DRAMCACHE_ASSOC : 1;
+
+    if(SIM_MODE == SIM_MODE_A){
+      die_message("dramcache needs mode 2 or 3");
+    }
+    if(!config_is_pow2(page) || page < L2CACHE_LINESIZE || page/L2CACHE_LINESIZE > DRAMCACHE_MAX_PAGE_LINES){
+      sprintf(msg, "dramcache page_size must be a power of two, 1 to %d L2 lines", DRAMCACHE_MAX_PAGE_LINES);
+      die_message(msg);
+    }
+    if(!config_is_pow2(ways) || DRAMCACHE_SIZE < page*ways || !config_is_pow2(DRAMCACHE_SIZE/(page*ways))){
+      die_message("dramcache size and assoc must be powers of two, at least one set");
+    }
+    if(!DRAMCACHE_CHANNELS){
+      die_message("dramcache channels must be at least 1");
+    }
+    if(!config_is_pow2(DRAMCACHE_MAP_ENTRIES) || !config_is_pow2(DRAMCACHE_FHT_ENTRIES)){
+      die_message("dramcache map_entries and fht_entries must be powers of two");
+    }
+  }
+
+  if(SYNTH_INSTS){
+    if(SYNTH_MEM_PCT > 100 || SYNTH_STORE_PCT > 100){
+      die_message("synth mem_pct and store_pct must be 0 to 100");
+    }
+    if(SYNTH_STREAM_PCT + SYNTH_CHASE_PCT + SYNTH_ZIPF_PCT != 100){
+      die_message("synth stream_pct, chase_pct and zipf_pct must sum to 100");
+    }
+    if(!SYNTH_STRIDE || SYNTH_STREAM_SIZE < SYNTH_STRIDE){
+      die_message("synth stride must be at least 1 and no larger than stream_kb");
+    }
+    if(!config_is_pow2(SYNTH_CHASE_SIZE) || SYNTH_CHASE_SIZE < TRACEGEN_NODE_BYTES){
+      die_message("synth chase_kb must be a power of two");
+    }
+    if(SYNTH_ZIPF_SIZE < 1024 || SYNTH_ZIPF_SIZE/TRACEGEN_NODE_BYTES >= (1ULL<<32)){
+      die_message("synth zipf_kb must be 1 KB to 256 GB");
+    }
+    if(SYNTH_ZIPF_THETA > 99){
+      die_message("synth zipf_theta must be 0 to 99 (hundredths)");
+    }
+    if(!SYNTH_CODE_SIZE || SYNTH_CODE_SIZE % (4*TRACEGEN_BLOCK_INSTS) ||
+       TRACEGEN_CODE_BASE + SYNTH_CODE_SIZE > TRACEGEN_DATA_BASE){
+      sprintf(msg, "synth code_kb must be a multiple of %d bytes, below the data at 0x%llx",
+	      4*TRACEGEN_BLOCK_INSTS, TRACEGEN_DATA_BASE);
+      die_message(msg);
+    }
+  }
+
+  if(PROFILE_TOPN && (!config_is_pow2(PROFILE_REGION) || PROFILE_REGION < CACHE_LINESIZE)){
+    die_message("profregion must be a power of two no smaller than linesize");
+  }
+}
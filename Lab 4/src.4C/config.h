@@ -0,0 +1,40 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "types.h"
+
+//////////////////////////////////////////////////////////////////
+// INI-style config file for the simulator parameters:
+//
+//   [sim]      mode, linesize, repl, sector_size, trace64, set_stats,
+//              fetchbuf_stats, wcb_entries, set_alloc
+//   [dcache]   size_kb, assoc, linesize, hit_latency, index, write_policy,
+//              write_miss, waypred*, e_* (pJ)
+//   [icache]   size_kb, assoc, linesize, hit_latency, index, waypred*,
+//              e_* (pJ)
+//   [l2cache]  size_kb, assoc, linesize, hit_latency, index, write_policy,
+//              write_miss, insert, bypass, bip_throttle, reuse_entries,
+//              waypred*, compress, decomp_latency, e_* (pJ)
+//   [core]     ooo, rob_size, width, lq_size, sq_size, mshrs
+//   [tlb]      enable, itlb/dtlb/stlb_entries, *_assoc, stlb_latency,
+//              hugepage_pct
+//   [dram]     banks, rowbuf_size, latency_fixed, t_act, t_cas, t_pre, t_bus,
+//              t_refi, t_rfc, t_rrd, t_faw, pd_threshold, t_xp, row_policy,
+//              row_timeout, bank_stats, e_* (pJ)
+//   [dramcache] org, size_mb, assoc, page_size, latency, tag_latency,
+//              channels, t_burst, predict, map_entries, fht_entries,
+//              e_burst (pJ)
+//   [synth]    insts, seed, mem_pct, store_pct, stream_pct, chase_pct,
+//              zipf_pct, stream_kb, stride, chase_kb, zipf_kb, zipf_theta,
+//              code_kb
+//
+// A cache linesize of 0 (the default) means [sim] linesize.
+// '#' or ';' start a comment. Keys not given keep their defaults,
+// and the file is read before the other command line options, so
+// those always override it wherever they appear.
+//////////////////////////////////////////////////////////////////
+
+void    config_load(const char *filename);
+void    config_validate(void);
+
+#endif // CONFIG_H
@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core.h"
+#include "stats.h"
+
+extern uns64 cycle_count;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Core *core_new(uns64 rob_size, uns64 width, uns64 lq_size, uns64 sq_size, uns64 mshrs){
+  Core *c = (Core *) calloc (1, sizeof (Core));
+
+  assert(rob_size && width && lq_size && sq_size);
+  c->rob_size = rob_size;
+  c->width    = width;
+  c->lq_size  = lq_size;
+  c->sq_size  = sq_size;
+  c->mshrs    = mshrs;
+
+  c->rob_free      = (uns64 *) calloc (rob_size, sizeof(uns64));
+  c->lq_free       = (uns64 *) calloc (lq_size, sizeof(uns64));
+  c->sq_free       = (uns64 *) calloc (sq_size, sizeof(uns64));
+  if(mshrs){
+    c->mshr_free   = (uns64 *) calloc (mshrs, sizeof(uns64));
+  }
+  c->dispatch_ring = (uns64 *) calloc (width, sizeof(uns64));
+  c->retire_ring   = (uns64 *) calloc (width, sizeof(uns64));
+
+  c->dispatch_cycle = cycle_count;
+  c->retire_cycle   = cycle_count;
+
+  return c;
+}
+
+////////////////////////////////////////////////////////////////////
+// Wait for a structure: returns the later of the two cycles and
+// charges the difference to the stall counter
+////////////////////////////////////////////////////////////////////
+
+static uns64 core_wait(uns64 cycle, uns64 free_cycle, uns64 *stat){
+  if(free_cycle > cycle){
+    *stat += free_cycle - cycle;
+    return free_cycle;
+  }
+  return cycle;
+}
+
+// the MSHR that frees first
+static uns64 *core_mshr_next(Core *c){
+  uns64 *next = &c->mshr_free[0];
+  uns64  ii;
+
+  for(ii=1; ii<c->mshrs; ii++){
+    if(c->mshr_free[ii] < *next){
+      next = &c->mshr_free[ii];
+    }
+  }
+  return next;
+}
+
+////////////////////////////////////////////////////////////////////
+// Time one instruction, given the delays of its memsys accesses
+////////////////////////////////////////////////////////////////////
+
+void core_step(Core *c, uns64 ifetch_delay, Inst_Type type, uns64 ldst_delay){
+  uns64 dispatch, complete, retire;
+  uns64 width_slot = c->num_inst % c->width;
+  uns64 rob_slot   = c->num_inst % c->rob_size;
+
+  // front end: in order behind the previous dispatch
+  dispatch = c->dispatch_cycle;
+  if(ifetch_delay > 1){
+    dispatch += ifetch_delay-1;
+    c->stat_fetch_stall += ifetch_delay-1;
+  }
+
+  if(c->num_inst >= c->width && c->dispatch_ring[width_slot] + 1 > dispatch){
+    dispatch = c->dispatch_ring[width_slot] + 1;
+  }
+  if(c->num_inst >= c->rob_size){
+    dispatch = core_wait(dispatch, c->rob_free[rob_slot], &c->stat_rob_full);
+  }
+  if(type==INST_TYPE_LOAD && c->num_load >= c->lq_size){
+    dispatch = core_wait(dispatch, c->lq_free[c->num_load % c->lq_size], &c->stat_lq_full);
+  }
+  if(type==INST_TYPE_STORE && c->num_store >= c->sq_size){
+    dispatch = core_wait(dispatch, c->sq_free[c->num_store % c->sq_size], &c->stat_sq_full);
+  }
+
+  complete = dispatch + 1;
+  if(type==INST_TYPE_LOAD && ldst_delay > 1){
+    uns64 issue = dispatch;
+
+    if(c->mshrs){
+      uns64 *mshr = core_mshr_next(c);
+
+      issue = core_wait(dispatch, *mshr, &c->stat_mshr_full);
+      *mshr = issue + ldst_delay;
+    }
+    complete = issue + ldst_delay;
+
+    // MLP: union of the cycles with a load miss outstanding
+    c->stat_miss_cycles += ldst_delay;
+    if(complete > c->miss_busy_end){
+      c->stat_miss_busy += complete - ((issue > c->miss_busy_end) ? issue : c->miss_busy_end);
+      c->miss_busy_end = complete;
+    }
+  }
+
+  retire = complete;
+  if(retire < c->retire_cycle){
+    retire = c->retire_cycle;
+  }
+  if(c->num_inst >= c->width && c->retire_ring[width_slot] + 1 > retire){
+    retire = c->retire_ring[width_slot] + 1;
+  }
+
+  c->dispatch_ring[width_slot] = dispatch;
+  c->retire_ring[width_slot]   = retire;
+  c->rob_free[rob_slot]        = retire;
+
+  if(type==INST_TYPE_LOAD){
+    c->lq_free[c->num_load++ % c->lq_size] = retire;
+  }
+  if(type==INST_TYPE_STORE){
+    // with store buffers the write drains after retire
+    c->sq_free[c->num_store++ % c->sq_size] = retire + ldst_delay;
+  }
+
+  c->num_inst++;
+  c->dispatch_cycle = dispatch;
+  c->retire_cycle   = retire;
+  cycle_count = dispatch;
+}
+
+void core_finish(Core *c){
+  cycle_count = c->retire_cycle;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void core_register_stats(Core *c){
+  stats_register("CORE", "ROB_FULL_STALLS", &c->stat_rob_full);
+  stats_register("CORE", "LQ_FULL_STALLS",  &c->stat_lq_full);
+  stats_register("CORE", "SQ_FULL_STALLS",  &c->stat_sq_full);
+  stats_register("CORE", "MSHR_FULL_STALLS", &c->stat_mshr_full);
+  stats_register("CORE", "FETCH_STALLS",    &c->stat_fetch_stall);
+  stats_register("CORE", "MISS_CYCLES",     &c->stat_miss_cycles);
+  stats_register("CORE", "MISS_BUSY",       &c->stat_miss_busy);
+  stats_register_ratio("CORE", "MLP", &c->stat_miss_cycles, &c->stat_miss_busy);
+}
+
+void core_print(Core *c){
+  char   header[256];
+  double mlp = 0;
+
+  sprintf(header, "CORE");
+
+  if(c->stat_miss_busy){
+    mlp = (double)(c->stat_miss_cycles)/(double)(c->stat_miss_busy);
+  }
+
+  printf("\n");
+  printf("\n%s_ROB_SIZE       \t\t : %10llu", header, c->rob_size);
+  printf("\n%s_WIDTH          \t\t : %10llu", header, c->width);
+  printf("\n%s_ROB_FULL_STALLS\t\t : %10llu", header, c->stat_rob_full);
+  printf("\n%s_LQ_FULL_STALLS \t\t : %10llu", header, c->stat_lq_full);
+  printf("\n%s_SQ_FULL_STALLS \t\t : %10llu", header, c->stat_sq_full);
+  printf("\n%s_MSHR_FULL_STALLS\t\t : %10llu", header, c->stat_mshr_full);
+  printf("\n%s_FETCH_STALLS   \t\t : %10llu", header, c->stat_fetch_stall);
+  printf("\n%s_MLP            \t\t : %10.3f", header, mlp);
+  printf("\n");
+}
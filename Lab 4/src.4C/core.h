@@ -0,0 +1,73 @@
+#ifndef CORE_H
+#define CORE_H
+
+#include "types.h"
+
+//////////////////////////////////////////////////////////////////
+// Out-of-order core timing (-ooo 1), replacing the 1 IPC blocking
+// pipeline. Each instruction is processed in program order after
+// its memsys accesses, and its dispatch, complete and retire
+// cycles are computed from:
+//
+//   - front end: an ifetch delay stalls dispatch of the instruction
+//   - dispatch:  in order, at most W per cycle, needs a free ROB
+//                entry, and an LQ/SQ entry for loads/stores
+//   - complete:  dispatch + load delay (1 cycle for the others); a
+//                load miss first waits for a free L1D MSHR (-mshrs,
+//                0: unlimited), later instructions still dispatch
+//   - retire:    in order, at most W per cycle
+//
+// The trace has no register dependences, so loads are independent
+// and their latencies overlap as far as the ROB, LQ and MSHRs allow.
+// A load miss is a load with a delay over 1 cycle; the caches have
+// already been updated when it waits for an MSHR.
+// Stores leave the SQ when their write completes after retire.
+// cycle_count follows the dispatch cycle (so it remains the LRU
+// timestamp) and is set to the last retire cycle by core_finish.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Core Core;
+
+
+struct Core {
+  uns64  rob_size;
+  uns64  width;
+  uns64  lq_size;
+  uns64  sq_size;
+  uns64  mshrs;         // 0: unlimited
+
+  uns64 *rob_free;      // cycle each ROB entry frees (retire)
+  uns64 *lq_free;       // cycle each LQ entry frees (retire)
+  uns64 *sq_free;       // cycle each SQ entry frees (write done)
+  uns64 *mshr_free;     // cycle each MSHR frees (load miss done)
+  uns64 *dispatch_ring; // dispatch cycle of the last W instructions
+  uns64 *retire_ring;   // retire cycle of the last W instructions
+
+  uns64  num_inst;
+  uns64  num_load;
+  uns64  num_store;
+  uns64  dispatch_cycle; // of the latest instruction
+  uns64  retire_cycle;   // of the latest instruction
+  uns64  miss_busy_end;  // end of the latest outstanding load miss
+
+  // stats
+  uns64  stat_rob_full;      // dispatch cycles lost to a full ROB
+  uns64  stat_lq_full;
+  uns64  stat_sq_full;
+  uns64  stat_mshr_full;     // cycles load misses waited for an MSHR
+  uns64  stat_fetch_stall;   // dispatch cycles lost to ifetch delay
+  uns64  stat_miss_cycles;   // summed latency of load misses
+  uns64  stat_miss_busy;     // cycles with at least one load miss pending
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Core   *core_new(uns64 rob_size, uns64 width, uns64 lq_size, uns64 sq_size, uns64 mshrs);
+void    core_step(Core *c, uns64 ifetch_delay, Inst_Type type, uns64 ldst_delay);
+void    core_finish(Core *c);
+void    core_register_stats(Core *c);
+void    core_print(Core *c);
+
+#endif // CORE_H
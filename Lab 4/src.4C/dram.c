@@ -3,24 +3,41 @@
 #include <stdlib.h>
 
 #include "dram.h"
+#include "stats.h"
 
-#define ROWBUF_SIZE         1024
-#define DRAM_BANKS          16
+extern MODE   SIM_MODE;
+extern uns64  L2CACHE_LINESIZE;
+
+extern uns64  ROWBUF_SIZE;
+extern uns64  DRAM_BANKS;
 
 //---- Latency for Part B ------
 
-#define DRAM_LATENCY_FIXED  100
+extern uns64  DRAM_LATENCY_FIXED;
 
 //---- Latencies for Part C ------
 
-#define DRAM_T_ACT         45
-#define DRAM_T_CAS         45
-#define DRAM_T_PRE         45
-#define DRAM_T_BUS         10
+extern uns64  DRAM_T_ACT;
+extern uns64  DRAM_T_CAS;
+extern uns64  DRAM_T_PRE;
+extern uns64  DRAM_T_BUS;
 
+//---- Part C timing constraints, 0 turns each off ------
 
-extern MODE   SIM_MODE;
-extern uns64  CACHE_LINESIZE;
+extern uns64  DRAM_T_REFI;
+extern uns64  DRAM_T_RFC;
+extern uns64  DRAM_T_RRD;
+extern uns64  DRAM_T_FAW;
+extern uns64  DRAM_PD_THRESHOLD;
+extern uns64  DRAM_T_XP;
+
+//---- Part C row buffer policy ------
+
+extern uns64  DRAM_ROW_POLICY;
+extern uns64  DRAM_ROW_TIMEOUT;
+extern uns64  DRAM_BANK_STATS;
+
+extern uns64  cycle_count;
 
 
 ///////////////////////////////////////////////////////////////////
@@ -60,6 +77,23 @@ void    dram_print_stats(DRAM *dram){
 ///////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////
 
+void    dram_register_stats(DRAM *dram){
+  stats_register("DRAM", "READ_ACCESS",  &dram->stat_read_access);
+  stats_register("DRAM", "WRITE_ACCESS", &dram->stat_write_access);
+  stats_register("DRAM", "READ_DELAY",   &dram->stat_read_delay);
+  stats_register("DRAM", "WRITE_DELAY",  &dram->stat_write_delay);
+  stats_register("DRAM", "ROW_HIT",      &dram->stat_row_hit);
+  stats_register("DRAM", "ROW_MISS",     &dram->stat_row_miss);
+  stats_register("DRAM", "ROW_EMPTY",    &dram->stat_row_empty);
+
+  stats_register_ratio("DRAM", "READ_DELAY_AVG",  &dram->stat_read_delay,  &dram->stat_read_access);
+  stats_register_ratio("DRAM", "WRITE_DELAY_AVG", &dram->stat_write_delay, &dram->stat_write_access);
+  stats_register_ratio("DRAM", "ROW_HITRATE",     &dram->stat_row_hit,     &dram->stat_row_access);
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
 uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write){
   uns64 delay=DRAM_LATENCY_FIXED;
 
@@ -84,11 +118,160 @@ uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write){
 // Modify the function below only if you are attempting Part C
 ///////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////
+// Part C timing constraints. An access arrives at cycle_count (the
+// core's time; several accesses of one instruction arrive together)
+// and may wait, in order, for:
+//
+//   - power-down exit: the DRAM powers down after DRAM_PD_THRESHOLD
+//     idle cycles, the next access pays tXP (rows stay open)
+//   - refresh: every tREFI cycles all banks refresh for tRFC, an
+//     access in that window waits for the end, and rows are closed
+//   - activates: at least tRRD apart, at most 4 in any tFAW window
+//
+// The waits are added to the row hit/miss/empty latency.
+///////////////////////////////////////////////////////////////////
+
+Flag    dram_timing_enabled(void){
+  return DRAM_T_REFI || DRAM_T_RRD || DRAM_T_FAW || DRAM_PD_THRESHOLD;
+}
+
+static Flag dram_wait(uns64 *time, uns64 ready, uns64 *stat_cycles){
+  if(ready > *time){
+    *stat_cycles += ready - *time;
+    *time = ready;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// earliest cycle at or after act_time that a new activate may issue
+static uns64 dram_activate(DRAM *dram, uns64 act_time){
+  if(DRAM_T_RRD && dram->num_act &&
+     dram_wait(&act_time, dram->last_act + DRAM_T_RRD, &dram->stat_act_cycles)){
+    dram->stat_rrd_stalls++;
+  }
+  if(DRAM_T_FAW && dram->num_act >= DRAM_FAW_ACTS &&
+     dram_wait(&act_time, dram->faw_act[dram->faw_next] + DRAM_T_FAW, &dram->stat_act_cycles)){
+    dram->stat_faw_stalls++;
+  }
+
+  dram->last_act = act_time;
+  dram->faw_act[dram->faw_next] = act_time;
+  dram->faw_next = (dram->faw_next + 1) % DRAM_FAW_ACTS;
+  dram->num_act++;
+  return act_time;
+}
+
+///////////////////////////////////////////////////////////////////
+// Row buffer policy, applied after each access. A precharge issued
+// by the policy starts once the bank is idle (when the access
+// completes, or when the timeout expires) and takes tPRE. The next
+// access finds the bank empty: an ACT instead of a row hit if it
+// goes to the same row (a regret), or instead of PRE+ACT if it goes
+// to another row. If it arrives before the precharge is done, it
+// also waits for the rest of it.
+///////////////////////////////////////////////////////////////////
+
+static void dram_row_close(DRAM *dram, Rowbuf_Entry *bank, uns64 start){
+  bank->valid = FALSE;
+  bank->policy_closed = TRUE;
+  bank->pre_done = start + DRAM_T_PRE;
+  dram->stat_row_closes++;
+}
+
+static void dram_row_policy(DRAM *dram, Rowbuf_Entry *bank, uns64 rowid, uns64 issue, uns64 done){
+  if(DRAM_ROW_POLICY == ROW_PREDICT && bank->accessed){
+    // train on whether this access would have hit the last row
+    if(bank->last_rowid == rowid){
+      if(bank->close_ctr > 0)
+        bank->close_ctr--;
+    }else if(bank->close_ctr < 3){
+      bank->close_ctr++;
+    }
+  }
+
+  bank->accessed = TRUE;
+  bank->last_rowid = rowid;
+  if(issue > bank->last_access){
+    bank->last_access = issue;
+  }
+  if(done > bank->done){
+    bank->done = done;
+  }
+
+  if(DRAM_ROW_POLICY == ROW_CLOSED || (DRAM_ROW_POLICY == ROW_PREDICT && bank->close_ctr >= 2)){
+    dram_row_close(dram, bank, bank->done);
+  }
+}
+
 uns64   dram_access_extra_credit(DRAM *dram,Addr lineaddr, Flag is_dram_write){
   uns64 delay=0;
+  uns64 issue=cycle_count;
+  uns64 act_wait=0;
+
+    if(DRAM_PD_THRESHOLD && issue > dram->busy_until + DRAM_PD_THRESHOLD)
+    {
+      dram->stat_pd_exits++;
+      dram->stat_pd_cycles += issue - (dram->busy_until + DRAM_PD_THRESHOLD);
+      issue += DRAM_T_XP;
+    }
 
-    Addr BankID = (lineaddr >> 4) % DRAM_BANKS;
-    Addr RowID = (lineaddr >> 4) / DRAM_BANKS;
+    if(DRAM_T_RFC && DRAM_T_REFI && issue % DRAM_T_REFI < DRAM_T_RFC)
+    {
+      dram->stat_refresh_stalls++;
+      dram_wait(&issue, issue - issue % DRAM_T_REFI + DRAM_T_RFC, &dram->stat_refresh_cycles);
+    }
+
+    // consecutive lines share a row, consecutive rows go to consecutive banks
+    Addr rowbuf_lines = ROWBUF_SIZE / L2CACHE_LINESIZE;
+    Addr BankID = (lineaddr / rowbuf_lines) % DRAM_BANKS;
+    Addr RowID = (lineaddr / rowbuf_lines) / DRAM_BANKS;
+
+    dram->stat_row_access++;
+
+    // a refresh since the last access to the bank closed its row
+    if(DRAM_T_REFI && dram->perbank_row_buf[BankID].valid &&
+       dram->perbank_row_buf[BankID].refresh_epoch != issue / DRAM_T_REFI)
+    {
+      dram->perbank_row_buf[BankID].valid = FALSE;
+      dram->stat_refresh_closes++;
+    }
+    if(DRAM_T_REFI)
+    {
+      dram->perbank_row_buf[BankID].refresh_epoch = issue / DRAM_T_REFI;
+    }
+
+    if(DRAM_ROW_POLICY == ROW_TIMEOUT && dram->perbank_row_buf[BankID].valid &&
+       issue > dram->perbank_row_buf[BankID].last_access + DRAM_ROW_TIMEOUT)
+    {
+      // the precharge starts at the timeout, or when the bank goes idle
+      uns64 start = dram->perbank_row_buf[BankID].last_access + DRAM_ROW_TIMEOUT;
+      if(dram->perbank_row_buf[BankID].done > start)
+      {
+        start = dram->perbank_row_buf[BankID].done;
+      }
+      dram_row_close(dram, &dram->perbank_row_buf[BankID], start);
+    }
+    if(dram->perbank_row_buf[BankID].policy_closed)
+    {
+      if(dram->perbank_row_buf[BankID].last_rowid == RowID)
+      {
+        dram->stat_close_regret++;
+      }
+      // the rest of the precharge; a still busy bank is not modeled
+      // for the other policies either, so the wait is at most tPRE
+      uns64 pre_done = dram->perbank_row_buf[BankID].pre_done;
+      if(pre_done > issue + DRAM_T_PRE)
+      {
+        pre_done = issue + DRAM_T_PRE;
+      }
+      if(dram_wait(&issue, pre_done, &dram->stat_close_cycles))
+      {
+        dram->stat_close_stalls++;
+      }
+      dram->perbank_row_buf[BankID].policy_closed = FALSE;
+    }
 
     if(dram->perbank_row_buf[BankID].valid)
     {
@@ -96,11 +279,16 @@ uns64   dram_access_extra_credit(DRAM *dram,Addr lineaddr, Flag is_dram_write){
       {
 
         dram->perbank_row_buf[BankID].rowid = RowID;
+        dram->stat_row_miss++;
+        dram->stat_bank_miss[BankID]++;
         delay= DRAM_T_PRE + DRAM_T_ACT + DRAM_T_CAS + DRAM_T_BUS;
+        act_wait = dram_activate(dram, issue + DRAM_T_PRE) - (issue + DRAM_T_PRE);
       }
       else
       {
         // is valid and matches rowID
+        dram->stat_row_hit++;
+        dram->stat_bank_hit[BankID]++;
         delay = DRAM_T_CAS + DRAM_T_BUS;
       }
     }
@@ -109,9 +297,138 @@ uns64   dram_access_extra_credit(DRAM *dram,Addr lineaddr, Flag is_dram_write){
     {
         dram->perbank_row_buf[BankID].rowid = RowID;
         dram->perbank_row_buf[BankID].valid = TRUE;
+        dram->stat_row_empty++;
+        dram->stat_bank_empty[BankID]++;
         delay = DRAM_T_ACT + DRAM_T_CAS + DRAM_T_BUS;
+        act_wait = dram_activate(dram, issue) - issue;
+    }
+
+    delay += (issue - cycle_count) + act_wait;
+    dram_row_policy(dram, &dram->perbank_row_buf[BankID], RowID, issue, cycle_count + delay);
+
+    if(cycle_count + delay > dram->busy_until)
+    {
+      dram->busy_until = cycle_count + delay;
+    }
+    if(!is_dram_write)
+    {
+      dram->stat_read_hist[(delay < DRAM_DELAY_HIST) ? delay : DRAM_DELAY_HIST]++;
+      if(delay > dram->stat_read_delay_max)
+      {
+        dram->stat_read_delay_max = delay;
+      }
     }
 
 
   return delay;
 }
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+// smallest delay that at least pct percent of the reads do not exceed
+static uns64 dram_read_percentile(DRAM *dram, uns64 pct){
+  uns64 total=0, sum=0, ii;
+
+  for(ii=0; ii<=DRAM_DELAY_HIST; ii++){
+    total += dram->stat_read_hist[ii];
+  }
+  for(ii=0; ii<=DRAM_DELAY_HIST; ii++){
+    sum += dram->stat_read_hist[ii];
+    if(sum*100 >= total*pct){
+      return (ii < DRAM_DELAY_HIST) ? ii : dram->stat_read_delay_max;
+    }
+  }
+  return 0;
+}
+
+void    dram_register_timing_stats(DRAM *dram){
+  stats_register("DRAM", "REFRESH_STALLS",  &dram->stat_refresh_stalls);
+  stats_register("DRAM", "REFRESH_CYCLES",  &dram->stat_refresh_cycles);
+  stats_register("DRAM", "REFRESH_CLOSES",  &dram->stat_refresh_closes);
+  stats_register("DRAM", "RRD_STALLS",      &dram->stat_rrd_stalls);
+  stats_register("DRAM", "FAW_STALLS",      &dram->stat_faw_stalls);
+  stats_register("DRAM", "ACT_WAIT_CYCLES", &dram->stat_act_cycles);
+  stats_register("DRAM", "PD_EXITS",        &dram->stat_pd_exits);
+  stats_register("DRAM", "PD_CYCLES",       &dram->stat_pd_cycles);
+  stats_register("DRAM", "READ_DELAY_MAX",  &dram->stat_read_delay_max);
+}
+
+void    dram_print_timing_stats(DRAM *dram){
+  char header[256];
+  sprintf(header, "DRAM");
+
+  printf("\n");
+  printf("\n%s_REFRESH_STALLS  \t\t : %10llu", header, dram->stat_refresh_stalls);
+  printf("\n%s_REFRESH_CYCLES  \t\t : %10llu", header, dram->stat_refresh_cycles);
+  printf("\n%s_REFRESH_CLOSES  \t\t : %10llu", header, dram->stat_refresh_closes);
+  printf("\n%s_RRD_STALLS      \t\t : %10llu", header, dram->stat_rrd_stalls);
+  printf("\n%s_FAW_STALLS      \t\t : %10llu", header, dram->stat_faw_stalls);
+  printf("\n%s_ACT_WAIT_CYCLES \t\t : %10llu", header, dram->stat_act_cycles);
+  printf("\n%s_PD_EXITS        \t\t : %10llu", header, dram->stat_pd_exits);
+  printf("\n%s_PD_CYCLES       \t\t : %10llu", header, dram->stat_pd_cycles);
+  printf("\n%s_READ_DELAY_P50  \t\t : %10llu", header, dram_read_percentile(dram, 50));
+  printf("\n%s_READ_DELAY_P99  \t\t : %10llu", header, dram_read_percentile(dram, 99));
+  printf("\n%s_READ_DELAY_MAX  \t\t : %10llu", header, dram->stat_read_delay_max);
+  printf("\n");
+}
+
+///////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////
+
+void    dram_register_row_stats(DRAM *dram){
+  char  name[64];
+  uns64 ii;
+
+  stats_register("DRAM", "ROW_CLOSES",      &dram->stat_row_closes);
+  stats_register("DRAM", "ROW_CLOSE_REGRET", &dram->stat_close_regret);
+  stats_register("DRAM", "ROW_CLOSE_STALLS", &dram->stat_close_stalls);
+  stats_register("DRAM", "ROW_CLOSE_CYCLES", &dram->stat_close_cycles);
+  if(!DRAM_BANK_STATS){
+    return;
+  }
+  for(ii=0; ii<DRAM_BANKS; ii++){
+    sprintf(name, "BANK%llu_ROW_HIT", ii);
+    stats_register("DRAM", name, &dram->stat_bank_hit[ii]);
+    sprintf(name, "BANK%llu_ROW_MISS", ii);
+    stats_register("DRAM", name, &dram->stat_bank_miss[ii]);
+    sprintf(name, "BANK%llu_ROW_EMPTY", ii);
+    stats_register("DRAM", name, &dram->stat_bank_empty[ii]);
+  }
+}
+
+void    dram_print_row_stats(DRAM *dram){
+  static const char *policy_names[] = { "open", "closed", "timeout", "predict" };
+  char   header[256];
+  char   name[64];
+  double hitrate=0;
+  uns64  ii;
+
+  sprintf(header, "DRAM");
+
+  if(dram->stat_row_access){
+    hitrate = (double)(dram->stat_row_hit)/(double)(dram->stat_row_access);
+  }
+
+  printf("\n");
+  printf("\n%s_ROW_POLICY      \t\t : %10s",   header, policy_names[DRAM_ROW_POLICY]);
+  printf("\n%s_ROW_HIT         \t\t : %10llu", header, dram->stat_row_hit);
+  printf("\n%s_ROW_MISS        \t\t : %10llu", header, dram->stat_row_miss);
+  printf("\n%s_ROW_EMPTY       \t\t : %10llu", header, dram->stat_row_empty);
+  printf("\n%s_ROW_HITRATE     \t\t : %10.3f", header, hitrate);
+  printf("\n%s_ROW_CLOSES      \t\t : %10llu", header, dram->stat_row_closes);
+  printf("\n%s_ROW_CLOSE_REGRET\t\t : %10llu", header, dram->stat_close_regret);
+  printf("\n%s_ROW_CLOSE_STALLS\t\t : %10llu", header, dram->stat_close_stalls);
+  printf("\n%s_ROW_CLOSE_CYCLES\t\t : %10llu", header, dram->stat_close_cycles);
+  if(DRAM_BANK_STATS){
+    for(ii=0; ii<DRAM_BANKS; ii++){
+      sprintf(name, "BANK%llu_ROW_HIT", ii);
+      printf("\n%s_%-16s\t\t : %10llu", header, name, dram->stat_bank_hit[ii]);
+      sprintf(name, "BANK%llu_ROW_MISS", ii);
+      printf("\n%s_%-16s\t\t : %10llu", header, name, dram->stat_bank_miss[ii]);
+      sprintf(name, "BANK%llu_ROW_EMPTY", ii);
+      printf("\n%s_%-16s\t\t : %10llu", header, name, dram->stat_bank_empty[ii]);
+    }
+  }
+  printf("\n");
+}
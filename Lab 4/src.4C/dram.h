@@ -8,6 +8,16 @@
 #include "types.h"
 
 #define MAX_DRAM_BANKS          256
+#define DRAM_FAW_ACTS           4     // activates allowed per tFAW window
+#define DRAM_DELAY_HIST         1024  // read delay histogram, 1 cycle bins
+
+typedef enum Row_Policy_Enum {
+    ROW_OPEN=0,     // leave the row open after an access
+    ROW_CLOSED=1,   // precharge right after every access
+    ROW_TIMEOUT=2,  // precharge once the bank idles DRAM_ROW_TIMEOUT cycles
+    ROW_PREDICT=3,  // per-bank history: precharge if the next access is
+                    // predicted to go to another row
+} Row_Policy;
 
 
 
@@ -21,6 +31,16 @@ typedef struct Rowbuf_Entry Rowbuf_Entry;
 struct Rowbuf_Entry {
   Flag valid; // 0 means the rowbuffer entry is invalid
   uns64 rowid; // If the entry is valid, which row?
+  uns64 refresh_epoch; // refresh interval of the last access (tREFI)
+
+  // row policy state, kept whether or not the row is still open
+  Flag  accessed;      // the bank has been accessed
+  Flag  policy_closed; // the row policy precharged it after the last access
+  uns8  close_ctr;     // ROW_PREDICT: 2-bit counter, >= 2 predicts a row change
+  uns64 last_rowid;
+  uns64 last_access;   // cycle of the last access
+  uns64 done;          // cycle the last access completed
+  uns64 pre_done;      // cycle the policy precharge completes
 };
 
 
@@ -32,6 +52,36 @@ struct DRAM {
   uns64 stat_write_access;
   uns64 stat_read_delay;
   uns64 stat_write_delay;
+  uns64 stat_row_access; // Part C row buffer outcomes
+  uns64 stat_row_hit;
+  uns64 stat_row_miss;
+  uns64 stat_row_empty;
+
+  // Part C timing constraints (all off by default)
+  uns64 busy_until;                  // end of the latest access, for power-down
+  uns64 last_act;                    // latest activate, for tRRD
+  uns64 faw_act[DRAM_FAW_ACTS];      // latest activates, for tFAW
+  uns   faw_next;
+  uns64 num_act;
+
+  uns64 stat_refresh_stalls;  // accesses that waited for a refresh
+  uns64 stat_refresh_cycles;
+  uns64 stat_refresh_closes;  // open rows closed by a refresh
+  uns64 stat_rrd_stalls;      // activates delayed by tRRD
+  uns64 stat_faw_stalls;      // activates delayed by tFAW
+  uns64 stat_act_cycles;      // cycles of both
+  uns64 stat_pd_exits;        // accesses that woke the DRAM from power-down
+  uns64 stat_pd_cycles;       // cycles spent in power-down
+  uns64 stat_read_hist[DRAM_DELAY_HIST+1]; // last bin: DRAM_DELAY_HIST and up
+  uns64 stat_read_delay_max;
+
+  uns64 stat_row_closes;      // early precharges by the row policy
+  uns64 stat_close_regret;    // ... where the next access was to the same row
+  uns64 stat_close_stalls;    // ... where the next access waited for it to finish
+  uns64 stat_close_cycles;    // cycles of those waits
+  uns64 stat_bank_hit[MAX_DRAM_BANKS];
+  uns64 stat_bank_miss[MAX_DRAM_BANKS];
+  uns64 stat_bank_empty[MAX_DRAM_BANKS];
 };
 
 
@@ -41,8 +91,14 @@ struct DRAM {
 
 DRAM   *dram_new();
 void    dram_print_stats(DRAM *dram);
+void    dram_register_stats(DRAM *dram);
 uns64   dram_access(DRAM *dram,Addr lineaddr, Flag is_dram_write);
 uns64   dram_access_extra_credit(DRAM *dram,Addr lineaddr, Flag is_dram_write);
+Flag    dram_timing_enabled(void);
+void    dram_register_timing_stats(DRAM *dram);
+void    dram_print_timing_stats(DRAM *dram);
+void    dram_register_row_stats(DRAM *dram);
+void    dram_print_row_stats(DRAM *dram);
 
 
 
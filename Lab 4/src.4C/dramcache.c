@@ -0,0 +1,414 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dramcache.h"
+#include "stats.h"
+
+extern uns64  DRAMCACHE_ORG;
+extern uns64  DRAMCACHE_SIZE;
+extern uns64  DRAMCACHE_ASSOC;
+extern uns64  DRAMCACHE_PAGE_SIZE;
+extern uns64  DRAMCACHE_LATENCY;
+extern uns64  DRAMCACHE_TAG_LATENCY;
+extern uns64  DRAMCACHE_CHANNELS;
+extern uns64  DRAMCACHE_T_BURST;
+extern uns64  DRAMCACHE_PREDICT;
+extern uns64  DRAMCACHE_MAP_ENTRIES;
+extern uns64  DRAMCACHE_FHT_ENTRIES;
+
+extern uns64  cycle_count;
+
+void die_message(const char * msg);
+
+// Alloy entry: the line address with a valid and a dirty bit on top
+#define DRAMCACHE_VALID     (1ULL<<62)
+#define DRAMCACHE_DIRTY     (1ULL<<63)
+#define DRAMCACHE_TAG_MASK  (DRAMCACHE_VALID-1)
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static uns dramcache_log2(uns64 size){
+  uns bits=0;
+
+  while((1ULL<<bits) < size)
+    bits++;
+  return bits;
+}
+
+Dram_Cache *dramcache_new(DRAM *dram, uns64 linesize, uns64 sectors_per_line){
+  Dram_Cache *dc = (Dram_Cache *) calloc (1, sizeof (Dram_Cache));
+  uns64 ii;
+
+  dc->dram = dram;
+  dc->org = DRAMCACHE_ORG;
+  dc->sectors_per_line = sectors_per_line;
+  dc->sector_all = (sectors_per_line >= 64) ? ~0ULL : (1ULL<<sectors_per_line)-1;
+
+  if(dc->org == DRAMCACHE_ALLOY){
+    dc->assoc = 1;
+    dc->lines_per_page = 1;
+    dc->set_bytes = sizeof(uns64);
+    if(DRAMCACHE_PREDICT){
+      dc->map_entries = DRAMCACHE_MAP_ENTRIES;
+      dc->map_ctr = (uns8 *) calloc (dc->map_entries, sizeof(uns8));
+      for(ii=0; ii<dc->map_entries; ii++){
+        dc->map_ctr[ii] = DRAMCACHE_MAP_THRESHOLD; // weakly miss: the cache starts empty
+      }
+    }
+  }else{
+    dc->assoc = DRAMCACHE_ASSOC;
+    dc->lines_per_page = DRAMCACHE_PAGE_SIZE/linesize;
+    dc->set_bytes = dc->assoc*sizeof(Dram_Cache_Page);
+    dc->fht_entries = DRAMCACHE_FHT_ENTRIES;
+    dc->fht = (uns64 *) calloc (dc->fht_entries, sizeof(uns64));
+  }
+  assert(dc->lines_per_page <= DRAMCACHE_MAX_PAGE_LINES);
+  dc->page_shift = dramcache_log2(dc->lines_per_page);
+  dc->num_sets = DRAMCACHE_SIZE/(linesize*dc->lines_per_page*dc->assoc);
+  assert(dc->num_sets && !(dc->num_sets & (dc->num_sets-1)));
+
+  dc->sets_per_chunk = DRAMCACHE_CHUNK_BYTES/dc->set_bytes;
+  if(dc->sets_per_chunk == 0){
+    dc->sets_per_chunk = 1;
+  }
+  if(dc->sets_per_chunk > dc->num_sets){
+    dc->sets_per_chunk = dc->num_sets;
+  }
+  dc->num_chunks = (dc->num_sets + dc->sets_per_chunk - 1)/dc->sets_per_chunk;
+  dc->chunks = (void **) calloc (dc->num_chunks, sizeof(void *));
+
+  dc->num_channels = DRAMCACHE_CHANNELS;
+  dc->chan_busy = (uns64 *) calloc (dc->num_channels, sizeof(uns64));
+
+  return dc;
+}
+
+////////////////////////////////////////////////////////////////////
+// The entries of a set, allocating its chunk on first touch
+////////////////////////////////////////////////////////////////////
+
+static void *dramcache_set(Dram_Cache *dc, uns64 set){
+  uns64 chunk = set/dc->sets_per_chunk;
+
+  if(dc->chunks[chunk] == NULL){
+    dc->chunks[chunk] = calloc(dc->sets_per_chunk, dc->set_bytes);
+    if(dc->chunks[chunk] == NULL){
+      die_message("Out of host memory for the DRAM cache");
+    }
+    dc->stat_host_bytes += dc->sets_per_chunk*dc->set_bytes;
+  }
+  return (char *)dc->chunks[chunk] + (set % dc->sets_per_chunk)*dc->set_bytes;
+}
+
+// wait for the channel of lineaddr, then hold it for bursts line transfers
+static uns64 dramcache_channel(Dram_Cache *dc, Addr lineaddr, uns64 bursts){
+  uns64 *busy = &dc->chan_busy[lineaddr % dc->num_channels];
+  uns64  start = (*busy > cycle_count) ? *busy : cycle_count;
+
+  *busy = start + bursts*DRAMCACHE_T_BURST;
+  dc->stat_bursts += bursts;
+  dc->stat_queue_cycles += start - cycle_count;
+  return start - cycle_count;
+}
+
+// one DRAM read per sector in mask, returns the summed delay
+static uns64 dramcache_dram_read(Dram_Cache *dc, Addr lineaddr, uns64 mask){
+  uns64 delay=0;
+
+  while(mask){
+    delay += dram_access(dc->dram, lineaddr, FALSE);
+    mask &= mask-1;
+  }
+  return delay;
+}
+
+static void dramcache_dram_write(Dram_Cache *dc, Addr lineaddr, uns64 mask){
+  while(mask){
+    dram_access(dc->dram, lineaddr, TRUE);
+    mask &= mask-1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Alloy: direct-mapped TAD entries
+////////////////////////////////////////////////////////////////////
+
+static void dramcache_alloy_install(Dram_Cache *dc, uns64 *entry, Addr lineaddr, Flag dirty){
+  if((*entry & DRAMCACHE_VALID) && (*entry & DRAMCACHE_DIRTY)){
+    dramcache_dram_write(dc, *entry & DRAMCACHE_TAG_MASK, dc->sector_all);
+    dc->stat_evict_dirty++;
+  }
+  *entry = lineaddr | DRAMCACHE_VALID | (dirty ? DRAMCACHE_DIRTY : 0);
+  dramcache_channel(dc, lineaddr, 1);
+}
+
+static uns64 dramcache_alloy_read(Dram_Cache *dc, Addr lineaddr, uns64 mask, Addr pc){
+  uns64 *entry = (uns64 *) dramcache_set(dc, lineaddr & (dc->num_sets-1));
+  uns64  probe = DRAMCACHE_LATENCY + dramcache_channel(dc, lineaddr, 1);
+  Flag   hit = (*entry & DRAMCACHE_VALID) && (*entry & DRAMCACHE_TAG_MASK) == lineaddr;
+  Flag   pred_miss = FALSE;
+  uns64  delay;
+
+  if(dc->map_ctr){
+    uns8 *ctr = &dc->map_ctr[((pc>>2) ^ (pc>>11)) & (dc->map_entries-1)];
+
+    pred_miss = (*ctr >= DRAMCACHE_MAP_THRESHOLD);
+    if(hit && *ctr > 0){
+      (*ctr)--;
+    }
+    if(!hit && *ctr < DRAMCACHE_MAP_MAX){
+      (*ctr)++;
+    }
+  }
+
+  if(hit){
+    dc->stat_read_hit++;
+    if(pred_miss){
+      // the DRAM read issued alongside the probe was not needed
+      dramcache_dram_read(dc, lineaddr, mask);
+      dc->stat_pred_wasted++;
+    }
+    return probe;
+  }
+
+  delay = dramcache_dram_read(dc, lineaddr, mask);
+  if(pred_miss){
+    delay = (delay > probe) ? delay : probe;
+  }else{
+    delay += probe;
+    dc->stat_pred_serial += (dc->map_ctr != NULL);
+  }
+
+  // the rest of the line comes along, off the critical path
+  dramcache_dram_read(dc, lineaddr, dc->sector_all & ~mask);
+  dramcache_alloy_install(dc, entry, lineaddr, FALSE);
+  return delay;
+}
+
+static void dramcache_alloy_write(Dram_Cache *dc, Addr lineaddr, uns64 mask){
+  uns64 *entry = (uns64 *) dramcache_set(dc, lineaddr & (dc->num_sets-1));
+
+  if((*entry & DRAMCACHE_VALID) && (*entry & DRAMCACHE_TAG_MASK) == lineaddr){
+    *entry |= DRAMCACHE_DIRTY;
+    dramcache_channel(dc, lineaddr, 1);
+    dc->stat_write_hit++;
+  }else if(mask == dc->sector_all){
+    dramcache_alloy_install(dc, entry, lineaddr, TRUE);
+    dc->stat_write_alloc++;
+  }else{
+    dramcache_dram_write(dc, lineaddr, mask);
+    dc->stat_write_around++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Footprint: set-associative pages with per-line valid/dirty masks
+////////////////////////////////////////////////////////////////////
+
+static Dram_Cache_Page *dramcache_page_find(Dram_Cache *dc, Dram_Cache_Page *set, Addr page){
+  uns64 ii;
+
+  for(ii=0; ii<dc->assoc; ii++){
+    if(set[ii].valid && set[ii].tag == page){
+      return &set[ii];
+    }
+  }
+  return NULL;
+}
+
+// evicts the LRU page (an invalid one if any); the used lines train its signature
+static Dram_Cache_Page *dramcache_page_victim(Dram_Cache *dc, Dram_Cache_Page *set){
+  Dram_Cache_Page *victim = &set[0];
+  uns64 dirty, ii;
+
+  for(ii=0; ii<dc->assoc && victim->valid; ii++){
+    if(!set[ii].valid || set[ii].last_access < victim->last_access){
+      victim = &set[ii];
+    }
+  }
+  if(!victim->valid){
+    return victim;
+  }
+
+  dc->fht[victim->sig] = victim->used_mask;
+  dc->stat_unused_lines += __builtin_popcountll(victim->valid_mask & ~victim->used_mask);
+  for(dirty=victim->dirty_mask; dirty; dirty&=dirty-1){
+    dramcache_dram_write(dc, (victim->tag << dc->page_shift) | __builtin_ctzll(dirty), dc->sector_all);
+    dc->stat_evict_dirty++;
+  }
+  victim->valid = FALSE;
+  return victim;
+}
+
+static uns64 dramcache_fp_read(Dram_Cache *dc, Addr lineaddr, uns64 mask, Addr pc){
+  Addr  page = lineaddr >> dc->page_shift;
+  uns   off  = lineaddr & (dc->lines_per_page-1);
+  uns64 bit  = 1ULL<<off;
+  Dram_Cache_Page *set = (Dram_Cache_Page *) dramcache_set(dc, page & (dc->num_sets-1));
+  Dram_Cache_Page *p = dramcache_page_find(dc, set, page);
+  uns64 delay = DRAMCACHE_TAG_LATENCY;
+  uns64 fetch, others;
+
+  if(p && (p->valid_mask & bit)){
+    dc->stat_read_hit++;
+    p->used_mask |= bit;
+    p->last_access = ++dc->seq;
+    return delay + DRAMCACHE_LATENCY + dramcache_channel(dc, lineaddr, 1);
+  }
+
+  delay += dramcache_dram_read(dc, lineaddr, mask);
+  dramcache_dram_read(dc, lineaddr, dc->sector_all & ~mask);
+
+  if(p){
+    // the page is here but the footprint missed this line
+    dc->stat_line_miss++;
+    p->valid_mask |= bit;
+    p->used_mask |= bit;
+    p->last_access = ++dc->seq;
+    dramcache_channel(dc, lineaddr, 1);
+    return delay;
+  }
+
+  p = dramcache_page_victim(dc, set);
+  p->sig = (uns)((((pc>>2) ^ (pc>>13))*dc->lines_per_page + off) & (dc->fht_entries-1));
+  fetch = dc->fht[p->sig] | bit;
+
+  // the other predicted lines are fetched off the critical path
+  for(others=fetch & ~bit; others; others&=others-1){
+    dramcache_dram_read(dc, (page << dc->page_shift) | __builtin_ctzll(others), dc->sector_all);
+  }
+
+  p->valid = TRUE;
+  p->tag = page;
+  p->valid_mask = fetch;
+  p->dirty_mask = 0;
+  p->used_mask = bit;
+  p->last_access = ++dc->seq;
+  dc->stat_fetch_lines += __builtin_popcountll(fetch);
+  dramcache_channel(dc, lineaddr, __builtin_popcountll(fetch));
+  return delay;
+}
+
+// writes do not allocate pages: a full line can fill a resident page
+static void dramcache_fp_write(Dram_Cache *dc, Addr lineaddr, uns64 mask){
+  Addr  page = lineaddr >> dc->page_shift;
+  uns64 bit  = 1ULL << (lineaddr & (dc->lines_per_page-1));
+  Dram_Cache_Page *set = (Dram_Cache_Page *) dramcache_set(dc, page & (dc->num_sets-1));
+  Dram_Cache_Page *p = dramcache_page_find(dc, set, page);
+
+  if(p && ((p->valid_mask & bit) || mask == dc->sector_all)){
+    if(p->valid_mask & bit){
+      dc->stat_write_hit++;
+    }else{
+      dc->stat_write_alloc++;
+    }
+    p->valid_mask |= bit;
+    p->dirty_mask |= bit;
+    p->used_mask |= bit;
+    p->last_access = ++dc->seq;
+    dramcache_channel(dc, lineaddr, 1);
+  }else{
+    dramcache_dram_write(dc, lineaddr, mask);
+    dc->stat_write_around++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// L2 miss for the sectors in mask: returns the delay to get them
+////////////////////////////////////////////////////////////////////
+
+uns64 dramcache_read(Dram_Cache *dc, Addr lineaddr, uns64 mask, Addr pc){
+  uns64 delay;
+
+  if(dc->org == DRAMCACHE_ALLOY){
+    delay = dramcache_alloy_read(dc, lineaddr, mask, pc);
+  }else{
+    delay = dramcache_fp_read(dc, lineaddr, mask, pc);
+  }
+
+  dc->stat_read_access++;
+  dc->stat_read_delay += delay;
+  return delay;
+}
+
+////////////////////////////////////////////////////////////////////
+// L2 write (writeback or write-through) of the sectors in mask
+////////////////////////////////////////////////////////////////////
+
+void dramcache_write(Dram_Cache *dc, Addr lineaddr, uns64 mask){
+  if(dc->org == DRAMCACHE_ALLOY){
+    dramcache_alloy_write(dc, lineaddr, mask);
+  }else{
+    dramcache_fp_write(dc, lineaddr, mask);
+  }
+
+  dc->stat_write_access++;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void dramcache_register_stats(Dram_Cache *dc){
+  stats_register("DRAMCACHE", "READ_ACCESS",  &dc->stat_read_access);
+  stats_register("DRAMCACHE", "READ_HIT",     &dc->stat_read_hit);
+  stats_register("DRAMCACHE", "READ_DELAY",   &dc->stat_read_delay);
+  stats_register("DRAMCACHE", "WRITE_ACCESS", &dc->stat_write_access);
+  stats_register("DRAMCACHE", "WRITE_HIT",    &dc->stat_write_hit);
+  stats_register("DRAMCACHE", "WRITE_ALLOC",  &dc->stat_write_alloc);
+  stats_register("DRAMCACHE", "WRITE_AROUND", &dc->stat_write_around);
+  stats_register("DRAMCACHE", "EVICT_DIRTY",  &dc->stat_evict_dirty);
+  if(dc->org == DRAMCACHE_ALLOY){
+    stats_register("DRAMCACHE", "PRED_SERIAL", &dc->stat_pred_serial);
+    stats_register("DRAMCACHE", "PRED_WASTED", &dc->stat_pred_wasted);
+  }else{
+    stats_register("DRAMCACHE", "LINE_MISS",    &dc->stat_line_miss);
+    stats_register("DRAMCACHE", "FETCH_LINES",  &dc->stat_fetch_lines);
+    stats_register("DRAMCACHE", "UNUSED_LINES", &dc->stat_unused_lines);
+  }
+  stats_register("DRAMCACHE", "BURSTS",       &dc->stat_bursts);
+  stats_register("DRAMCACHE", "QUEUE_CYCLES", &dc->stat_queue_cycles);
+  stats_register_ratio("DRAMCACHE", "HITRATE",        &dc->stat_read_hit,   &dc->stat_read_access);
+  stats_register_ratio("DRAMCACHE", "READ_DELAY_AVG", &dc->stat_read_delay, &dc->stat_read_access);
+}
+
+void dramcache_print(Dram_Cache *dc){
+  char   header[256];
+  double hitrate=0, delay_avg=0, pred_acc=0;
+
+  sprintf(header, "DRAMCACHE");
+
+  if(dc->stat_read_access){
+    hitrate = (double)(dc->stat_read_hit)/(double)(dc->stat_read_access);
+    delay_avg = (double)(dc->stat_read_delay)/(double)(dc->stat_read_access);
+    pred_acc = 1.0 - (double)(dc->stat_pred_serial + dc->stat_pred_wasted)/(double)(dc->stat_read_access);
+  }
+
+  printf("\n");
+  printf("\n%s_ORG            \t\t : %10s",   header, (dc->org == DRAMCACHE_ALLOY) ? "alloy" : "footprint");
+  printf("\n%s_SIZE_MB        \t\t : %10llu", header, DRAMCACHE_SIZE/(1024*1024));
+  printf("\n%s_READ_ACCESS    \t\t : %10llu", header, dc->stat_read_access);
+  printf("\n%s_READ_HIT       \t\t : %10llu", header, dc->stat_read_hit);
+  printf("\n%s_HITRATE        \t\t : %10.3f", header, hitrate);
+  printf("\n%s_READ_DELAY_AVG \t\t : %10.3f", header, delay_avg);
+  printf("\n%s_WRITE_ACCESS   \t\t : %10llu", header, dc->stat_write_access);
+  printf("\n%s_WRITE_HIT      \t\t : %10llu", header, dc->stat_write_hit);
+  printf("\n%s_WRITE_ALLOC    \t\t : %10llu", header, dc->stat_write_alloc);
+  printf("\n%s_WRITE_AROUND   \t\t : %10llu", header, dc->stat_write_around);
+  printf("\n%s_EVICT_DIRTY    \t\t : %10llu", header, dc->stat_evict_dirty);
+  if(dc->org == DRAMCACHE_ALLOY && dc->map_ctr){
+    printf("\n%s_PRED_SERIAL    \t\t : %10llu", header, dc->stat_pred_serial);
+    printf("\n%s_PRED_WASTED    \t\t : %10llu", header, dc->stat_pred_wasted);
+    printf("\n%s_PRED_ACCURACY  \t\t : %10.3f", header, pred_acc);
+  }
+  if(dc->org == DRAMCACHE_FOOTPRINT){
+    printf("\n%s_LINE_MISS      \t\t : %10llu", header, dc->stat_line_miss);
+    printf("\n%s_FETCH_LINES    \t\t : %10llu", header, dc->stat_fetch_lines);
+    printf("\n%s_UNUSED_LINES   \t\t : %10llu", header, dc->stat_unused_lines);
+  }
+  printf("\n%s_BURSTS         \t\t : %10llu", header, dc->stat_bursts);
+  printf("\n%s_QUEUE_CYCLES   \t\t : %10llu", header, dc->stat_queue_cycles);
+  printf("\n%s_HOST_MB        \t\t : %10.3f", header, (double)(dc->stat_host_bytes)/(1024.0*1024.0));
+  printf("\n");
+}
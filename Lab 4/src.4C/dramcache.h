@@ -0,0 +1,113 @@
+#ifndef DRAMCACHE_H
+#define DRAMCACHE_H
+
+#include "types.h"
+#include "dram.h"
+
+#define DRAMCACHE_CHUNK_BYTES   (2*1024*1024) // host memory per lazily allocated chunk of sets
+#define DRAMCACHE_MAX_PAGE_LINES 64           // footprint masks are uns64
+#define DRAMCACHE_MAP_MAX       7             // 3-bit MAP-I counters
+#define DRAMCACHE_MAP_THRESHOLD 4             // counter >= 4 predicts a miss
+
+typedef enum Dram_Cache_Org_Enum {
+    DRAMCACHE_OFF=0,
+    DRAMCACHE_ALLOY=1,      // direct-mapped, tag and data read in one burst
+    DRAMCACHE_FOOTPRINT=2,  // set-associative pages, SRAM tags, lines
+                            // fetched by a per-PC footprint prediction
+} Dram_Cache_Org;
+
+//////////////////////////////////////////////////////////////////
+// In-package DRAM cache (HBM tier) between the L2 and the DRAM.
+// It holds L2 lines: L2 misses read through it and L2 writes go to
+// it, and its own misses and dirty evictions go to dram_access.
+//
+// Alloy: one tag-and-data (TAD) entry per set, so a lookup costs a
+// DRAM cache access even on a miss. A MAP-I predictor (PC-indexed
+// 3-bit counters) sends predicted misses to DRAM in parallel with
+// the probe; a wrong miss prediction wastes the DRAM read, a wrong
+// hit prediction pays the probe and the DRAM read in series.
+//
+// Footprint: pages of DRAMCACHE_PAGE_SIZE bytes with tags in SRAM,
+// so a miss is known after DRAMCACHE_TAG_LATENCY. A page miss
+// fetches the lines its (PC, offset) signature used last time, and
+// the lines used while resident train the signature on eviction.
+//
+// Latency is DRAMCACHE_LATENCY plus the wait for a channel: each
+// line moved holds one of DRAMCACHE_CHANNELS for DRAMCACHE_T_BURST
+// cycles. A write updates a present line, a full-line write also
+// fills an Alloy entry or a line of a resident page, and any other
+// write goes around to DRAM.
+//
+// Entries are allocated in DRAMCACHE_CHUNK_BYTES chunks of sets on
+// first touch (an Alloy entry is one packed uns64), so host memory
+// follows the footprint of the trace, not the simulated capacity.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Dram_Cache_Page Dram_Cache_Page;
+typedef struct Dram_Cache Dram_Cache;
+
+
+struct Dram_Cache_Page {
+  Flag   valid;
+  Addr   tag;          // page number
+  uns    sig;          // footprint signature of the miss that allocated it
+  uns64  valid_mask;   // lines present
+  uns64  dirty_mask;
+  uns64  used_mask;    // lines read or written while resident
+  uns64  last_access;  // LRU
+};
+
+
+struct Dram_Cache {
+  DRAM   *dram;
+  uns     org;
+  uns64   num_sets;
+  uns64   assoc;            // 1 for Alloy
+  uns64   sectors_per_line; // DRAM transfers per line
+  uns64   sector_all;
+  uns64   lines_per_page;   // 1 for Alloy
+  uns     page_shift;
+
+  uns64   set_bytes;
+  uns64   sets_per_chunk;
+  uns64   num_chunks;
+  void  **chunks;           // NULL until a set in the chunk is touched
+  uns64   seq;              // LRU clock
+
+  uns8   *map_ctr;          // Alloy miss predictor, NULL if off
+  uns64   map_entries;
+  uns64  *fht;              // Footprint history: lines used per signature
+  uns64   fht_entries;
+  uns64  *chan_busy;        // cycle each channel is free again
+  uns64   num_channels;
+
+  // stats
+  uns64   stat_read_access;
+  uns64   stat_read_hit;
+  uns64   stat_read_delay;
+  uns64   stat_write_access;
+  uns64   stat_write_hit;
+  uns64   stat_write_alloc;
+  uns64   stat_write_around;
+  uns64   stat_evict_dirty;    // dirty lines written to DRAM
+  uns64   stat_pred_serial;    // predicted hit, was a miss
+  uns64   stat_pred_wasted;    // predicted miss, was a hit
+  uns64   stat_line_miss;      // Footprint: page present, line not
+  uns64   stat_fetch_lines;    // Footprint: lines fetched on page misses
+  uns64   stat_unused_lines;   // Footprint: fetched, evicted unused
+  uns64   stat_bursts;
+  uns64   stat_queue_cycles;
+  uns64   stat_host_bytes;
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Dram_Cache *dramcache_new(DRAM *dram, uns64 linesize, uns64 sectors_per_line);
+uns64   dramcache_read(Dram_Cache *dc, Addr lineaddr, uns64 mask, Addr pc);
+void    dramcache_write(Dram_Cache *dc, Addr lineaddr, uns64 mask);
+void    dramcache_register_stats(Dram_Cache *dc);
+void    dramcache_print(Dram_Cache *dc);
+
+#endif // DRAMCACHE_H
@@ -0,0 +1,23 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include "types.h"
+
+//////////////////////////////////////////////////////////////////
+// 64-bit mix (the MurmurHash3 fmix64 finalizer). Indexes the open
+// addressing tables of the profiler, the trace analysis and the
+// compression size map, so strided keys spread out, and makes the
+// repeatable per-address random choices (sampling, compressed
+// sizes, huge pages, page table frames).
+//////////////////////////////////////////////////////////////////
+
+static inline uns64 hash_mix(uns64 key){
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+#endif // HASH_H
@@ -0,0 +1,271 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "l2stream.h"
+#include "stats.h"
+
+void die_message(const char * msg);
+
+// kind byte: bits 0-1 Access_Type, then flags
+#define L2STREAM_KIND_TYPE   0x03
+#define L2STREAM_KIND_WB     0x04  // dcache writeback
+#define L2STREAM_KIND_CYCLE  0x08  // first request of an instruction, L1 time delta follows
+#define L2STREAM_KIND_MASK   0x10  // sector mask follows
+#define L2STREAM_END         0xFF  // trailer follows
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static void l2stream_put_byte(L2_Stream *s, uns8 byte){
+  putc(byte, s->fp);
+  s->stat_bytes++;
+}
+
+static void l2stream_put_varint(L2_Stream *s, uns64 value){
+  while(value >= 0x80){
+    l2stream_put_byte(s, (uns8)(value | 0x80));
+    value >>= 7;
+  }
+  l2stream_put_byte(s, (uns8)value);
+}
+
+static uns8 l2stream_get_byte(L2_Stream *s){
+  int byte = getc(s->fp);
+
+  if(byte == EOF){
+    die_message("L2 request stream is truncated");
+  }
+  s->stat_bytes++;
+  return (uns8)byte;
+}
+
+static uns64 l2stream_get_varint(L2_Stream *s){
+  uns64 value = 0;
+  uns   shift = 0;
+  uns8  byte;
+
+  do{
+    byte = l2stream_get_byte(s);
+    value |= (uns64)(byte & 0x7F) << shift;
+    shift += 7;
+  }while((byte & 0x80) && shift < 64);
+
+  return value;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+L2_Stream *l2stream_open(const char *filename, Flag replay, uns64 linesize, uns64 sectors_per_line){
+  L2_Stream *s = (L2_Stream *) calloc (1, sizeof (L2_Stream));
+  size_t     len = strlen(filename);
+  char       msg[1100];
+
+  s->replay = replay;
+  s->linesize = linesize;
+  s->sector_all = (sectors_per_line >= 64) ? ~0ULL : (1ULL<<sectors_per_line)-1;
+
+  if(len >= 3 && !strcmp(filename + len - 3, ".gz")){
+    sprintf(msg, replay ? "gunzip -c %.1000s" : "gzip -c > %.1000s", filename);
+    s->fp = popen(msg, replay ? "r" : "w");
+    s->is_pipe = TRUE;
+  }else{
+    s->fp = fopen(filename, replay ? "rb" : "wb");
+  }
+
+  if(s->fp == NULL){
+    sprintf(msg, "Unable to open the L2 request stream %.900s", filename);
+    die_message(msg);
+  }
+
+  if(!replay){
+    fwrite(L2STREAM_MAGIC, 1, L2STREAM_MAGIC_LEN, s->fp);
+    s->stat_bytes += L2STREAM_MAGIC_LEN;
+    l2stream_put_varint(s, linesize);
+    l2stream_put_varint(s, sectors_per_line);
+  }else{
+    char magic[L2STREAM_MAGIC_LEN];
+
+    if(fread(magic, 1, L2STREAM_MAGIC_LEN, s->fp) != L2STREAM_MAGIC_LEN ||
+       memcmp(magic, L2STREAM_MAGIC, L2STREAM_MAGIC_LEN)){
+      sprintf(msg, "%.900s is not an L2 request stream", filename);
+      die_message(msg);
+    }
+    s->stat_bytes += L2STREAM_MAGIC_LEN;
+    if(l2stream_get_varint(s) != linesize || l2stream_get_varint(s) != sectors_per_line){
+      die_message("L2 request stream was recorded with a different linesize or sector_size");
+    }
+  }
+
+  return s;
+}
+
+////////////////////////////////////////////////////////////////////
+// Append one request. cycle is cycle_count when it was issued: a
+// new value means a new instruction, so the L2 stall of the previous
+// one is part of cycle and is taken out to get the L1-only time.
+////////////////////////////////////////////////////////////////////
+
+void l2stream_record(L2_Stream *s, uns64 cycle, L2_Stream_Rec *rec){
+  uns8  kind = rec->type | (rec->is_writeback ? L2STREAM_KIND_WB : 0);
+  int64 addr_delta = (int64)(rec->lineaddr - s->last_lineaddr);
+  uns64 l1_cycle = s->l1_cycle;
+
+  assert(!s->replay);
+
+  if(cycle != s->last_cycle){
+    s->stall_committed += s->stall_pending;
+    s->stall_pending = 0;
+    s->last_cycle = cycle;
+    l1_cycle = cycle - s->stall_committed;
+    kind |= L2STREAM_KIND_CYCLE;
+  }
+  if(rec->mask != s->sector_all){
+    kind |= L2STREAM_KIND_MASK;
+  }
+
+  l2stream_put_byte(s, kind);
+  if(kind & L2STREAM_KIND_CYCLE){
+    l2stream_put_varint(s, l1_cycle - s->l1_cycle);
+  }
+  l2stream_put_varint(s, ((uns64)addr_delta << 1) ^ (uns64)(addr_delta >> 63));
+  if(kind & L2STREAM_KIND_MASK){
+    l2stream_put_varint(s, rec->mask);
+  }
+
+  s->l1_cycle = l1_cycle;
+  s->last_lineaddr = rec->lineaddr;
+  s->stat_records++;
+  s->stat_writebacks += rec->is_writeback;
+}
+
+////////////////////////////////////////////////////////////////////
+// Read the next request and the cycle_count to issue it at; returns
+// FALSE (after reading the trailer) at the end of the stream
+////////////////////////////////////////////////////////////////////
+
+Flag l2stream_next(L2_Stream *s, uns64 *cycle, L2_Stream_Rec *rec){
+  uns8  kind;
+  uns64 zigzag;
+  uns   ii;
+
+  assert(s->replay);
+
+  kind = l2stream_get_byte(s);
+  if(kind == L2STREAM_END){
+    s->inst_count   = l2stream_get_varint(s);
+    s->end_l1_cycle = l2stream_get_varint(s);
+    for(ii=0; ii<3; ii++){
+      s->access[ii]   = l2stream_get_varint(s);
+      s->l1_delay[ii] = l2stream_get_varint(s);
+    }
+    s->fetchbuf_hits = l2stream_get_varint(s);
+    for(ii=0; ii<2; ii++){
+      s->l1_tag_reads[ii]   = l2stream_get_varint(s);
+      s->l1_data_reads[ii]  = l2stream_get_varint(s);
+      s->l1_data_writes[ii] = l2stream_get_varint(s);
+    }
+    return FALSE;
+  }
+
+  if(kind & L2STREAM_KIND_CYCLE){
+    s->stall_committed += s->stall_pending;
+    s->stall_pending = 0;
+    s->l1_cycle += l2stream_get_varint(s);
+  }
+  zigzag = l2stream_get_varint(s);
+  s->last_lineaddr += (zigzag >> 1) ^ (0 - (zigzag & 1));
+
+  rec->lineaddr = s->last_lineaddr;
+  rec->mask = (kind & L2STREAM_KIND_MASK) ? l2stream_get_varint(s) : s->sector_all;
+  rec->type = (Access_Type)(kind & L2STREAM_KIND_TYPE);
+  rec->is_writeback = (kind & L2STREAM_KIND_WB) ? TRUE : FALSE;
+
+  *cycle = s->l1_cycle + s->stall_committed;
+  s->stat_records++;
+  s->stat_writebacks += rec->is_writeback;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////
+// L2 delay of the request: ifetch and load misses stall the
+// pipeline, stores are buffered and writebacks are off the path
+////////////////////////////////////////////////////////////////////
+
+void l2stream_delay(L2_Stream *s, L2_Stream_Rec *rec, uns64 delay){
+  if(rec->is_writeback){
+    return;
+  }
+
+  s->l2_delay[rec->type] += delay;
+  if(rec->type != ACCESS_TYPE_STORE){
+    s->stall_pending += delay;
+  }
+}
+
+// cycle_count at the end of the replayed run
+uns64 l2stream_end_cycle(L2_Stream *s){
+  return s->end_l1_cycle + s->stall_committed + s->stall_pending;
+}
+
+////////////////////////////////////////////////////////////////////
+// A recording stream gets its trailer here; the caller fills in
+// inst_count, end_l1_cycle, access, l1_delay, fetchbuf_hits and
+// the L1 energy counters
+////////////////////////////////////////////////////////////////////
+
+void l2stream_close(L2_Stream *s){
+  uns ii;
+
+  if(!s->replay){
+    l2stream_put_byte(s, L2STREAM_END);
+    l2stream_put_varint(s, s->inst_count);
+    l2stream_put_varint(s, s->end_l1_cycle);
+    for(ii=0; ii<3; ii++){
+      l2stream_put_varint(s, s->access[ii]);
+      l2stream_put_varint(s, s->l1_delay[ii]);
+    }
+    l2stream_put_varint(s, s->fetchbuf_hits);
+    for(ii=0; ii<2; ii++){
+      l2stream_put_varint(s, s->l1_tag_reads[ii]);
+      l2stream_put_varint(s, s->l1_data_reads[ii]);
+      l2stream_put_varint(s, s->l1_data_writes[ii]);
+    }
+  }
+
+  if(s->is_pipe){
+    pclose(s->fp);
+  }else{
+    fclose(s->fp);
+  }
+  s->fp = NULL;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void l2stream_register_stats(L2_Stream *s){
+  stats_register("L2STREAM", "RECORDS",    &s->stat_records);
+  stats_register("L2STREAM", "WRITEBACKS", &s->stat_writebacks);
+  stats_register("L2STREAM", "BYTES",      &s->stat_bytes);
+}
+
+void l2stream_print(L2_Stream *s){
+  char   header[256];
+  double bytes_per_rec = 0;
+
+  sprintf(header, "L2STREAM");
+
+  if(s->stat_records){
+    bytes_per_rec = (double)(s->stat_bytes)/(double)(s->stat_records);
+  }
+
+  printf("\n");
+  printf("\n%s_RECORDS        \t\t : %10llu", header, s->stat_records);
+  printf("\n%s_WRITEBACKS     \t\t : %10llu", header, s->stat_writebacks);
+  printf("\n%s_BYTES          \t\t : %10llu", header, s->stat_bytes);
+  printf("\n%s_BYTES_PER_REC  \t\t : %10.3f", header, bytes_per_rec);
+  printf("\n");
+}
@@ -0,0 +1,92 @@
+#ifndef L2STREAM_H
+#define L2STREAM_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+#define L2STREAM_MAGIC      "L2STRM1\n"
+#define L2STREAM_MAGIC_LEN  8
+
+//////////////////////////////////////////////////////////////////
+// L2 request stream: -l2record <file> runs the whole simulation and
+// writes every memsys_L2_access (icache/dcache fills, dcache
+// writebacks and page walk reads) to a file; -l2replay <file> then
+// feeds only those requests to the L2 and DRAM, so an L2/DRAM sweep
+// does not re-simulate the L1s for every point.
+//
+// Timing: with the 1 IPC pipeline the cycle count is the L1-only
+// time plus the L2 delays of the requests that stall the pipeline
+// (ifetch and load fills, and their page walks). The stream keeps
+// the L1-only time of each request, and replay adds back the L2
+// delays it computes, so cycle_count (the LRU timestamp) and CYCLES
+// come out as in a full run with the same L2/DRAM parameters.
+// This needs L1 hit latencies of at least 1 cycle, and is not valid
+// for the -ooo core. With -repl 1 the L2 victims differ from a full
+// run, since the L1s no longer draw from rand().
+//
+// Each record is a kind byte (access type, writeback, which fields
+// follow), then varints: L1 time delta (omitted within the same
+// instruction), zigzag line address delta, and the sector mask if
+// it is not the whole line. A trailer after an end byte carries the
+// instruction count, the L1 part of the memsys stats and the L1
+// energy counters. Files whose
+// name ends in .gz are piped through gzip.
+//////////////////////////////////////////////////////////////////
+
+typedef struct L2_Stream_Rec L2_Stream_Rec;
+typedef struct L2_Stream L2_Stream;
+
+
+struct L2_Stream_Rec {
+  Addr        lineaddr;
+  uns64       mask;
+  Access_Type type;         // access that caused it (walks: the translated access)
+  Flag        is_writeback;
+};
+
+
+struct L2_Stream {
+  FILE  *fp;
+  Flag   is_pipe;
+  Flag   replay;           // reading (-l2replay) instead of writing
+  uns64  linesize;
+  uns64  sector_all;       // mask of a whole line, not stored
+
+  Addr   last_lineaddr;
+  uns64  last_cycle;       // cycle_count of the previous request (record)
+  uns64  l1_cycle;         // L1-only time of the previous request
+  uns64  stall_committed;  // L2 stall cycles of earlier instructions
+  uns64  stall_pending;    // L2 stall cycles of the current instruction
+  uns64  l2_delay[3];      // L2 delay per Access_Type, excluding writebacks
+
+  // trailer: totals of the recorded run
+  uns64  inst_count;
+  uns64  end_l1_cycle;
+  uns64  access[3];        // memsys accesses per Access_Type
+  uns64  l1_delay[3];      // memsys delay per Access_Type minus l2_delay
+  uns64  fetchbuf_hits;
+  uns64  l1_tag_reads[2];   // L1 energy counters, DCACHE then ICACHE
+  uns64  l1_data_reads[2];
+  uns64  l1_data_writes[2];
+
+  // stats
+  uns64  stat_records;
+  uns64  stat_writebacks;
+  uns64  stat_bytes;       // uncompressed stream bytes
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+L2_Stream *l2stream_open(const char *filename, Flag replay, uns64 linesize, uns64 sectors_per_line);
+void       l2stream_record(L2_Stream *s, uns64 cycle, L2_Stream_Rec *rec);
+Flag       l2stream_next(L2_Stream *s, uns64 *cycle, L2_Stream_Rec *rec);
+void       l2stream_delay(L2_Stream *s, L2_Stream_Rec *rec, uns64 delay);
+uns64      l2stream_end_cycle(L2_Stream *s);
+void       l2stream_close(L2_Stream *s);
+void       l2stream_register_stats(L2_Stream *s);
+void       l2stream_print(L2_Stream *s);
+
+#endif // L2STREAM_H
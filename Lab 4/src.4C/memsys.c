@@ -5,39 +5,266 @@
 #include <math.h>
 
 #include "memsys.h"
+#include "stats.h"
 
 
-//---- Cache Latencies  ------
-
-#define DCACHE_HIT_LATENCY   1
-#define ICACHE_HIT_LATENCY   1
-#define L2CACHE_HIT_LATENCY  10
-
 extern MODE   SIM_MODE;
+extern uns64  cycle_count;
+extern uns64  inst_count;
 extern uns64  CACHE_LINESIZE;
 extern uns64  REPL_POLICY;
 
 extern uns64  DCACHE_SIZE;
 extern uns64  DCACHE_ASSOC;
+extern uns64  DCACHE_LINESIZE;
 extern uns64  ICACHE_SIZE;
 extern uns64  ICACHE_ASSOC;
+extern uns64  ICACHE_LINESIZE;
 extern uns64  L2CACHE_SIZE;
 extern uns64  L2CACHE_ASSOC;
+extern uns64  L2CACHE_LINESIZE;
+extern uns64  FETCHBUF_ENABLE;
+extern uns64  FETCHBUF_STATS;
+extern uns64  CACHE_KERNELS;
+extern uns64  CACHE_SET_ALLOC;
+extern uns64  SECTOR_SIZE;
+extern uns64  DCACHE_INDEX;
+extern uns64  ICACHE_INDEX;
+extern uns64  L2CACHE_INDEX;
+extern uns64  SET_STATS;
+extern uns64  DCACHE_WRITE_POLICY;
+extern uns64  DCACHE_WRITE_MISS;
+extern uns64  L2CACHE_WRITE_POLICY;
+extern uns64  L2CACHE_WRITE_MISS;
+extern uns64  WCB_ENTRIES;
+extern uns64  L2CACHE_INSERT;
+extern uns64  L2CACHE_BYPASS;
+extern uns64  BIP_THROTTLE;
+extern uns64  REUSE_ENTRIES;
+extern uns64  L2CACHE_COMPRESS;
+extern uns64  L2CACHE_DECOMP_LATENCY;
+extern char  *COMPRESS_MAP_FILE;
+extern char  *L2STREAM_RECORD_FILE;
+extern char  *L2STREAM_REPLAY_FILE;
+extern uns64  TLB_ENABLE;
+extern uns64  CORE_OOO;
+extern uns64  ROB_SIZE;
+extern uns64  CORE_WIDTH;
+extern uns64  LQ_SIZE;
+extern uns64  SQ_SIZE;
+extern uns64  CORE_MSHRS;
+extern uns64  PROFILE_TOPN;
+extern uns64  PROFILE_REGION;
+extern uns64  ANALYZE_SAMPLE;
+
+//---- Cache Latencies  ------
+
+extern uns64  DCACHE_HIT_LATENCY;
+extern uns64  ICACHE_HIT_LATENCY;
+extern uns64  L2CACHE_HIT_LATENCY;
+
+//---- Way prediction  ------
+
+extern uns64  DCACHE_WAYPRED;
+extern uns64  DCACHE_WAYPRED_LATENCY;
+extern uns64  DCACHE_WAYPRED_PENALTY;
+extern uns64  ICACHE_WAYPRED;
+extern uns64  ICACHE_WAYPRED_LATENCY;
+extern uns64  ICACHE_WAYPRED_PENALTY;
+extern uns64  L2CACHE_WAYPRED;
+extern uns64  L2CACHE_WAYPRED_LATENCY;
+extern uns64  L2CACHE_WAYPRED_PENALTY;
+
+//---- Energy per event and static energy per cycle (pJ) ------
+
+extern uns64  DCACHE_E_TAG;
+extern uns64  DCACHE_E_READ;
+extern uns64  DCACHE_E_WRITE;
+extern uns64  DCACHE_E_STATIC;
+extern uns64  ICACHE_E_TAG;
+extern uns64  ICACHE_E_READ;
+extern uns64  ICACHE_E_WRITE;
+extern uns64  ICACHE_E_STATIC;
+extern uns64  L2CACHE_E_TAG;
+extern uns64  L2CACHE_E_READ;
+extern uns64  L2CACHE_E_WRITE;
+extern uns64  L2CACHE_E_STATIC;
+extern uns64  DRAM_E_ACT;
+extern uns64  DRAM_E_PRE;
+extern uns64  DRAM_E_RD_BURST;
+extern uns64  DRAM_E_WR_BURST;
+extern uns64  DRAM_E_BACKGROUND;
+extern uns64  DRAM_ROW_POLICY;
+extern uns64  DRAM_BANK_STATS;
+extern uns64  DRAM_E_PD_BACKGROUND;
+extern uns64  DRAMCACHE_ORG;
+extern uns64  DRAMCACHE_E_BURST;
 
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
+static uns memsys_log2(uns64 size){
+  uns bits=0;
+
+  while((1ULL<<bits) < size)
+    bits++;
+  return bits;
+}
+
+// sectors per line of a cache: SECTOR_SIZE applies to every level
+static uns64 memsys_sectors(uns64 linesize){
+  return SECTOR_SIZE ? linesize/SECTOR_SIZE : 1;
+}
 
 Memsys *memsys_new(void)
 {
   Memsys *sys = (Memsys *) calloc (1, sizeof (Memsys));
+  uns64   last_linesize = (SIM_MODE==SIM_MODE_A) ? DCACHE_LINESIZE : L2CACHE_LINESIZE;
+
+  sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, DCACHE_LINESIZE, REPL_POLICY);
+  cache_enable_waypred(sys->dcache, DCACHE_WAYPRED, DCACHE_WAYPRED_LATENCY, DCACHE_WAYPRED_PENALTY, &sys->cur_pc);
+
+  // DRAM transfers are sectors of the last level (whole lines if unsectored)
+  sys->sector_size = SECTOR_SIZE ? SECTOR_SIZE : last_linesize;
+  sys->sectors_per_line = last_linesize/sys->sector_size;
+  sys->line_shift = memsys_log2(CACHE_LINESIZE);
+  sys->sector_shift = memsys_log2(sys->sector_size);
+  sys->dline_shift = memsys_log2(DCACHE_LINESIZE);
+  sys->iline_shift = memsys_log2(ICACHE_LINESIZE);
+  sys->l2line_shift = memsys_log2(L2CACHE_LINESIZE);
+  sys->dsector_mask = memsys_sectors(DCACHE_LINESIZE)-1;
+  sys->isector_mask = memsys_sectors(ICACHE_LINESIZE)-1;
+  cache_set_sectors(sys->dcache, memsys_sectors(DCACHE_LINESIZE));
+  cache_set_index_policy(sys->dcache, DCACHE_INDEX);
 
-  sys->dcache = cache_new(DCACHE_SIZE, DCACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+  if(ANALYZE_SAMPLE){
+    sys->analyze = analyze_new(ANALYZE_SAMPLE, CACHE_LINESIZE);
+  }
+
+  if(CORE_OOO){
+    sys->core = core_new(ROB_SIZE, CORE_WIDTH, LQ_SIZE, SQ_SIZE, CORE_MSHRS);
+  }
 
   if(SIM_MODE!=SIM_MODE_A){
-    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
-    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, CACHE_LINESIZE, REPL_POLICY);
+    sys->icache = cache_new(ICACHE_SIZE, ICACHE_ASSOC, ICACHE_LINESIZE, REPL_POLICY);
+    sys->l2cache = cache_new(L2CACHE_SIZE, L2CACHE_ASSOC, L2CACHE_LINESIZE, REPL_POLICY);
+    cache_enable_waypred(sys->icache, ICACHE_WAYPRED, ICACHE_WAYPRED_LATENCY, ICACHE_WAYPRED_PENALTY, &sys->cur_pc);
+    cache_enable_waypred(sys->l2cache, L2CACHE_WAYPRED, L2CACHE_WAYPRED_LATENCY, L2CACHE_WAYPRED_PENALTY, &sys->cur_pc);
+    cache_set_sectors(sys->icache, memsys_sectors(ICACHE_LINESIZE));
+    cache_set_sectors(sys->l2cache, memsys_sectors(L2CACHE_LINESIZE));
+    cache_set_index_policy(sys->icache, ICACHE_INDEX);
+    cache_set_index_policy(sys->l2cache, L2CACHE_INDEX);
+    cache_set_insertion(sys->l2cache, L2CACHE_INSERT, BIP_THROTTLE);
+    if(L2CACHE_INSERT==INSERT_PRED || L2CACHE_BYPASS){
+      // shadow of bypassed lines: about as many as the L2 holds
+      sys->reuse = reuse_new(REUSE_ENTRIES, 1ULL<<memsys_log2(L2CACHE_SIZE/L2CACHE_LINESIZE));
+    }
+    if(L2CACHE_COMPRESS){
+      cache_enable_compression(sys->l2cache, L2CACHE_LINESIZE);
+      sys->compress = compress_new(L2CACHE_LINESIZE, COMPRESS_MAP_FILE);
+    }
     sys->dram    = dram_new();
+    if(DRAMCACHE_ORG){
+      sys->dramcache = dramcache_new(sys->dram, L2CACHE_LINESIZE, sys->sectors_per_line);
+    }
+
+    if(PROFILE_TOPN){
+      sys->prof  = profile_new(PROFILE_REGION, PROFILE_TOPN);
+    }
+
+    // a replayed stream already holds the page walk reads
+    if(TLB_ENABLE && !L2STREAM_REPLAY_FILE){
+      sys->mmu   = mmu_new();
+    }
+
+    if(L2STREAM_RECORD_FILE){
+      sys->l2stream = l2stream_open(L2STREAM_RECORD_FILE, FALSE, L2CACHE_LINESIZE, sys->sectors_per_line);
+    }
+    if(L2STREAM_REPLAY_FILE){
+      sys->l2stream = l2stream_open(L2STREAM_REPLAY_FILE, TRUE, L2CACHE_LINESIZE, sys->sectors_per_line);
+    }
+
+    // a replayed stream already holds the DCACHE write traffic
+    if(DCACHE_WRITE_MISS==WRITE_COMBINE && !L2STREAM_REPLAY_FILE){
+      sys->dcache_wcb = wcb_new(WCB_ENTRIES);
+    }
+    if(L2CACHE_WRITE_MISS==WRITE_COMBINE){
+      sys->l2_wcb = wcb_new(WCB_ENTRIES);
+    }
+  }
+
+  if(SET_STATS){
+    cache_enable_set_stats(sys->dcache);
+    if(SIM_MODE!=SIM_MODE_A){
+      cache_enable_set_stats(sys->icache);
+      cache_enable_set_stats(sys->l2cache);
+    }
+  }
+
+  // geometry and index policy are final: lay out the sets and pick the cache kernels
+  cache_alloc_sets(sys->dcache, CACHE_SET_ALLOC);
+  cache_select_kernels(sys->dcache, CACHE_KERNELS);
+  if(SIM_MODE!=SIM_MODE_A){
+    cache_alloc_sets(sys->icache, CACHE_SET_ALLOC);
+    cache_alloc_sets(sys->l2cache, CACHE_SET_ALLOC);
+    cache_select_kernels(sys->icache, CACHE_KERNELS);
+    cache_select_kernels(sys->l2cache, CACHE_KERNELS);
+  }
+
+  stats_register("MEMSYS", "IFETCH_ACCESS", &sys->stat_ifetch_access);
+  stats_register("MEMSYS", "LOAD_ACCESS",   &sys->stat_load_access);
+  stats_register("MEMSYS", "STORE_ACCESS",  &sys->stat_store_access);
+  stats_register("MEMSYS", "IFETCH_DELAY",  &sys->stat_ifetch_delay);
+  stats_register("MEMSYS", "LOAD_DELAY",    &sys->stat_load_delay);
+  stats_register("MEMSYS", "STORE_DELAY",   &sys->stat_store_delay);
+  stats_register_ratio("MEMSYS", "IFETCH_AVGDELAY", &sys->stat_ifetch_delay, &sys->stat_ifetch_access);
+  stats_register_ratio("MEMSYS", "LOAD_AVGDELAY",   &sys->stat_load_delay,   &sys->stat_load_access);
+  stats_register_ratio("MEMSYS", "STORE_AVGDELAY",  &sys->stat_store_delay,  &sys->stat_store_access);
+
+  cache_register_stats(sys->dcache, "DCACHE");
+  if(sys->core){
+    core_register_stats(sys->core);
+  }
+
+  if(SIM_MODE!=SIM_MODE_A){
+    stats_register("MEMSYS", "FETCHBUF_HITS", &sys->stat_fetchbuf_hits);
+    cache_register_stats(sys->icache, "ICACHE");
+    cache_register_stats(sys->l2cache, "L2CACHE");
+    dram_register_stats(sys->dram);
+    if(dram_timing_enabled()){
+      dram_register_timing_stats(sys->dram);
+    }
+    if(SIM_MODE==SIM_MODE_C && (DRAM_ROW_POLICY || DRAM_BANK_STATS)){
+      dram_register_row_stats(sys->dram);
+    }
+    if(sys->dramcache){
+      dramcache_register_stats(sys->dramcache);
+    }
+    if(sys->compress){
+      compress_register_stats(sys->compress);
+    }
+    if(sys->mmu){
+      mmu_register_stats(sys->mmu);
+    }
+    if(sys->reuse){
+      reuse_register_stats(sys->reuse);
+    }
+    if(sys->l2stream){
+      l2stream_register_stats(sys->l2stream);
+    }
+    stats_register("TRAFFIC", "L1_L2_READ_BYTES",  &sys->stat_l1_read_bytes);
+    stats_register("TRAFFIC", "L1_L2_WRITE_BYTES", &sys->stat_l1_write_bytes);
+    stats_register("TRAFFIC", "DCACHE_WRITEBACKS",     &sys->stat_dcache_writebacks);
+    stats_register("TRAFFIC", "DCACHE_WRITETHROUGHS",  &sys->stat_dcache_writethroughs);
+    stats_register("TRAFFIC", "DCACHE_WRITEAROUNDS",   &sys->stat_dcache_writearounds);
+    stats_register("TRAFFIC", "L2CACHE_WRITETHROUGHS", &sys->stat_l2_writethroughs);
+    stats_register("TRAFFIC", "L2CACHE_WRITEAROUNDS",  &sys->stat_l2_writearounds);
+    if(sys->dcache_wcb){
+      wcb_register_stats(sys->dcache_wcb, "DCACHE_WCB");
+    }
+    if(sys->l2_wcb){
+      wcb_register_stats(sys->l2_wcb, "L2CACHE_WCB");
+    }
   }
 
   return sys;
@@ -46,6 +273,64 @@ Memsys *memsys_new(void)
 
 
 ////////////////////////////////////////////////////////////////////
+// One access of an instruction, shared by memsys_access and
+// memsys_access_batch: trace analysis, address translation, then
+// the L1 access in the current mode.
+////////////////////////////////////////////////////////////////////
+
+static inline uns64 memsys_access_line(Memsys *sys, Addr addr, Addr lineaddr, uns sector, Access_Type type,
+                                       uns64 (*access_fn)(Memsys *, Addr, Access_Type))
+{
+  uns64 delay=0;
+
+  sys->cur_sector=sector;
+  if(sys->analyze){
+    analyze_access(sys->analyze, sys->cur_pc, addr>>sys->line_shift, type);
+  }
+  if(sys->mmu){
+    delay=memsys_translate(sys, addr, type);
+  }
+  return delay+access_fn(sys, lineaddr, type);
+}
+
+////////////////////////////////////////////////////////////////////
+// Pipeline timing of one instruction once its accesses are done,
+// shared by the per-record and the batched trace loops: core_step
+// for the out-of-order core, else 1 IPC stalling on ifetch and load
+// delays (with store buffers, store misses do not stall). The stall
+// cycles are attributed to the instruction in the profile.
+////////////////////////////////////////////////////////////////////
+
+void memsys_retire(Memsys *sys, Trace_Rec *rec, uns64 ifetch_delay, uns64 ldst_delay)
+{
+  uns64 load_delay=(rec->inst_type==INST_TYPE_LOAD) ? ldst_delay : 0;
+
+  if(sys->core){
+    core_step(sys->core, ifetch_delay, rec->inst_type, ldst_delay);
+  }else{
+    cycle_count++; //assume 1 IPC for perfect pipeline
+
+    if(ifetch_delay>1){
+      cycle_count += (ifetch_delay-1);
+    }
+
+    if(load_delay>1){
+      cycle_count += (load_delay-1);
+    }
+  }
+
+  if(sys->prof){
+    if(ifetch_delay>1){
+      profile_stall(sys->prof, rec->inst_addr, rec->inst_addr, ifetch_delay-1);
+    }
+    if(load_delay>1){
+      profile_stall(sys->prof, rec->inst_addr, rec->ldst_addr, load_delay-1);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
 // This function takes an ifetch/ldst access and returns the delay
 ////////////////////////////////////////////////////////////////////
 
@@ -55,15 +340,19 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type)
 
 
   // all cache transactions happen at line granularity, so get lineaddr
-  Addr lineaddr=addr/CACHE_LINESIZE;
-
-
-  if(SIM_MODE==SIM_MODE_A){
-    delay = memsys_access_modeA(sys,lineaddr,type);
+  // (in units of the line size of the L1 being accessed)
+  Addr lineaddr;
+  uns  sector;
+  if(type==ACCESS_TYPE_IFETCH){
+    lineaddr=addr>>sys->iline_shift;
+    sector=(addr>>sys->sector_shift)&sys->isector_mask;
   }else{
-    delay = memsys_access_modeBC(sys,lineaddr,type);
+    lineaddr=addr>>sys->dline_shift;
+    sector=(addr>>sys->sector_shift)&sys->dsector_mask;
   }
 
+  delay=memsys_access_line(sys, addr, lineaddr, sector, type,
+                           (SIM_MODE==SIM_MODE_A) ? memsys_access_modeA : memsys_access_modeBC);
 
   //update the stats
   if(type==ACCESS_TYPE_IFETCH){
@@ -87,6 +376,113 @@ uns64 memsys_access(Memsys *sys, Addr addr, Access_Type type)
 
 
 
+////////////////////////////////////////////////////////////////////
+// Address translation before the cache access: TLB latency, plus a
+// page walk on an STLB miss whose page table reads go through the L2
+// (the L1 caches are not probed by the walker). The caches stay
+// virtually addressed, only the delay is added.
+////////////////////////////////////////////////////////////////////
+
+uns64 memsys_translate(Memsys *sys, Addr addr, Access_Type type)
+{
+  Addr  walk_addrs[MMU_LEVELS];
+  uns   num_walk, ii;
+  uns64 delay, walk_delay=0;
+
+  sys->cur_type=type;
+  delay=mmu_translate(sys->mmu, addr, type==ACCESS_TYPE_IFETCH, walk_addrs, &num_walk);
+  if(num_walk)
+  {
+      for(ii=0; ii<num_walk; ii++)
+      {
+          walk_delay+=memsys_L2_access(sys, walk_addrs[ii]>>sys->l2line_shift, FALSE);
+      }
+      mmu_walk_done(sys->mmu, walk_delay);
+  }
+
+  return delay+walk_delay;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Batched version of memsys_access for a block of trace records.
+// Same accesses in the same order as calling memsys_access per
+// record, but line addresses are computed up front and the stats
+// are accumulated locally and written back once per chunk.
+// The caches use cycle_count as the LRU timestamp, so cycle_count
+// is advanced after each record, with memsys_retire as in the
+// per-record loop.
+////////////////////////////////////////////////////////////////////
+
+void memsys_access_batch(Memsys *sys, Trace_Rec *recs, uns num_recs)
+{
+  Addr   inst_line[MEMSYS_BATCH_CHUNK];
+  Addr   ldst_line[MEMSYS_BATCH_CHUNK];
+  uns8   inst_sector[MEMSYS_BATCH_CHUNK];
+  uns8   ldst_sector[MEMSYS_BATCH_CHUNK];
+  uns64  (*access_fn)(Memsys *, Addr, Access_Type);
+  uns    iline_shift=sys->iline_shift, dline_shift=sys->dline_shift, sector_shift=sys->sector_shift;
+  uns64  isector_mask=sys->isector_mask, dsector_mask=sys->dsector_mask;
+  uns    base, ii;
+
+  access_fn = (SIM_MODE==SIM_MODE_A) ? memsys_access_modeA : memsys_access_modeBC;
+
+  for(base=0; base<num_recs; base+=MEMSYS_BATCH_CHUNK){
+    Trace_Rec *chunk=&recs[base];
+    uns    num=num_recs-base;
+    uns64  num_load=0, num_store=0;
+    uns64  ifetch_delay=0, load_delay=0, store_delay=0;
+
+    if(num > MEMSYS_BATCH_CHUNK){
+      num = MEMSYS_BATCH_CHUNK;
+    }
+
+    // all cache transactions happen at line granularity (shifts, as
+    // line and sector sizes are powers of two)
+    for(ii=0; ii<num; ii++){
+      inst_line[ii]=chunk[ii].inst_addr>>iline_shift;
+      ldst_line[ii]=chunk[ii].ldst_addr>>dline_shift;
+      inst_sector[ii]=(chunk[ii].inst_addr>>sector_shift)&isector_mask;
+      ldst_sector[ii]=(chunk[ii].ldst_addr>>sector_shift)&dsector_mask;
+      num_load  += (chunk[ii].inst_type==INST_TYPE_LOAD);
+      num_store += (chunk[ii].inst_type==INST_TYPE_STORE);
+    }
+
+    for(ii=0; ii<num; ii++){
+      uns64 delay, ifetch_inst_delay, ldst_inst_delay=0;
+
+      sys->cur_pc=chunk[ii].inst_addr;
+      delay=memsys_access_line(sys, chunk[ii].inst_addr, inst_line[ii], inst_sector[ii],
+                               ACCESS_TYPE_IFETCH, access_fn);
+      ifetch_delay+=delay;
+      ifetch_inst_delay=delay;
+
+      if(chunk[ii].inst_type==INST_TYPE_LOAD){
+        delay=memsys_access_line(sys, chunk[ii].ldst_addr, ldst_line[ii], ldst_sector[ii],
+                                 ACCESS_TYPE_LOAD, access_fn);
+        load_delay+=delay;
+        ldst_inst_delay=delay;
+      }
+      else if(chunk[ii].inst_type==INST_TYPE_STORE){
+        delay=memsys_access_line(sys, chunk[ii].ldst_addr, ldst_line[ii], ldst_sector[ii],
+                                 ACCESS_TYPE_STORE, access_fn);
+        store_delay+=delay;
+        ldst_inst_delay=delay;
+      }
+
+      memsys_retire(sys, &chunk[ii], ifetch_inst_delay, ldst_inst_delay);
+    }
+
+    sys->stat_ifetch_access += num;
+    sys->stat_load_access   += num_load;
+    sys->stat_store_access  += num_store;
+    sys->stat_ifetch_delay  += ifetch_delay;
+    sys->stat_load_delay    += load_delay;
+    sys->stat_store_delay   += store_delay;
+  }
+}
+
+
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
 
@@ -95,6 +491,9 @@ void memsys_print_stats(Memsys *sys)
   char header[256];
   sprintf(header, "MEMSYS");
 
+  // a replayed L2 stream has no L1 activity to report
+  Flag print_l1 = !(sys->l2stream && sys->l2stream->replay);
+
   double ifetch_delay_avg=0;
   double load_delay_avg=0;
   double store_delay_avg=0;
@@ -119,18 +518,224 @@ void memsys_print_stats(Memsys *sys)
   printf("\n%s_IFETCH_AVGDELAY\t\t : %10.3f",  header, ifetch_delay_avg);
   printf("\n%s_LOAD_AVGDELAY  \t\t : %10.3f",  header, load_delay_avg);
   printf("\n%s_STORE_AVGDELAY \t\t : %10.3f",  header, store_delay_avg);
+  // always in the stats registry, printed only on request
+  if(SIM_MODE!=SIM_MODE_A && FETCHBUF_STATS){
+    printf("\n%s_FETCHBUF_HITS  \t\t : %10llu",  header, sys->stat_fetchbuf_hits);
+  }
   printf("\n");
 
-  cache_print_stats(sys->dcache, "DCACHE");
+  if(print_l1){
+    cache_print_stats(sys->dcache, "DCACHE");
+  }
 
   if(SIM_MODE!=SIM_MODE_A){
-    cache_print_stats(sys->icache, "ICACHE");
+    if(print_l1){
+      cache_print_stats(sys->icache, "ICACHE");
+    }
     cache_print_stats(sys->l2cache, "L2CACHE");
     dram_print_stats(sys->dram);
+    if(SIM_MODE==SIM_MODE_C && dram_timing_enabled()){
+      dram_print_timing_stats(sys->dram);
+    }
+    if(SIM_MODE==SIM_MODE_C && (DRAM_ROW_POLICY || DRAM_BANK_STATS)){
+      dram_print_row_stats(sys->dram);
+    }
+    if(sys->dramcache){
+      dramcache_print(sys->dramcache);
+    }
+  }
+
+  printf("\n");
+  if(print_l1){
+    cache_print_lookup_stats(sys->dcache, "DCACHE");
+  }
+  if(SIM_MODE!=SIM_MODE_A){
+    if(print_l1){
+      cache_print_lookup_stats(sys->icache, "ICACHE");
+    }
+    cache_print_lookup_stats(sys->l2cache, "L2CACHE");
+  }
+
+  if(SET_STATS){
+    printf("\n");
+    if(print_l1){
+      cache_print_set_stats(sys->dcache, "DCACHE");
+    }
+    if(SIM_MODE!=SIM_MODE_A){
+      if(print_l1){
+        cache_print_set_stats(sys->icache, "ICACHE");
+      }
+      cache_print_set_stats(sys->l2cache, "L2CACHE");
+    }
+  }
+
+  if(sys->core){
+    core_print(sys->core);
+  }
+
+  if(sys->mmu){
+    mmu_print(sys->mmu);
+  }
+
+  if(sys->reuse){
+    reuse_print(sys->reuse);
+  }
+
+  if(sys->l2stream){
+    l2stream_print(sys->l2stream);
+  }
+
+  if(sys->compress){
+    printf("\n");
+    cache_print_compress_stats(sys->l2cache, "L2CACHE");
+    compress_print(sys->compress);
+  }
+
+  if(sys->sectors_per_line > 1){
+    printf("\n");
+    if(print_l1){
+      cache_print_sector_stats(sys->dcache, "DCACHE");
+    }
+    if(SIM_MODE!=SIM_MODE_A){
+      if(print_l1){
+        cache_print_sector_stats(sys->icache, "ICACHE");
+      }
+      cache_print_sector_stats(sys->l2cache, "L2CACHE");
+      printf("\nDRAM_BYTES_READ   \t\t : %10llu", sys->dram->stat_read_access*sys->sector_size);
+      printf("\nDRAM_BYTES_WRITTEN\t\t : %10llu", sys->dram->stat_write_access*sys->sector_size);
+      printf("\n");
+    }
+  }
+
+  if(SIM_MODE!=SIM_MODE_A){
+    memsys_print_traffic(sys, print_l1);
+  }
+
+  memsys_print_energy(sys);
+
+  if(sys->prof){
+    profile_print(sys->prof);
+  }
+
+  if(sys->analyze){
+    analyze_print(sys->analyze);
+  }
+
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Bytes moved between the levels, and what caused the writes. The
+// L1-L2 counts are in L1 sectors (lines if unsectored), the L2-DRAM
+// counts in sector_size transfers.
+////////////////////////////////////////////////////////////////////
+
+void memsys_print_traffic(Memsys *sys, Flag print_l1)
+{
+  char header[256];
+  sprintf(header, "TRAFFIC");
+
+  printf("\n");
+  if(print_l1){
+    printf("\n%s_L1_L2_READ_BYTES     \t : %10llu", header, sys->stat_l1_read_bytes);
+    printf("\n%s_L1_L2_WRITE_BYTES    \t : %10llu", header, sys->stat_l1_write_bytes);
+  }
+  printf("\n%s_L2_DRAM_READ_BYTES   \t : %10llu", header, sys->dram->stat_read_access*sys->sector_size);
+  printf("\n%s_L2_DRAM_WRITE_BYTES  \t : %10llu", header, sys->dram->stat_write_access*sys->sector_size);
+  if(print_l1){
+    printf("\n%s_DCACHE_WRITEBACKS    \t : %10llu", header, sys->stat_dcache_writebacks);
+    printf("\n%s_DCACHE_WRITETHROUGHS \t : %10llu", header, sys->stat_dcache_writethroughs);
+    printf("\n%s_DCACHE_WRITEAROUNDS  \t : %10llu", header, sys->stat_dcache_writearounds);
+  }
+  printf("\n%s_L2CACHE_WRITETHROUGHS\t : %10llu", header, sys->stat_l2_writethroughs);
+  printf("\n%s_L2CACHE_WRITEAROUNDS \t : %10llu", header, sys->stat_l2_writearounds);
+  printf("\n");
+
+  if(sys->dcache_wcb){
+    wcb_print(sys->dcache_wcb, "DCACHE_WCB");
   }
+  if(sys->l2_wcb){
+    wcb_print(sys->l2_wcb, "L2CACHE_WCB");
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Energy: per-event dynamic energy from the cache lookup/fill and
+// DRAM row buffer counters, plus static (background) energy for
+// every simulated cycle. Reported in nJ; EDP is nJ x cycles.
+////////////////////////////////////////////////////////////////////
 
+static double memsys_cache_energy(Cache *c, uns64 e_tag, uns64 e_read, uns64 e_write){
+  return (double)(c->stat_tag_reads  * e_tag +
+                  c->stat_data_reads * e_read +
+                  c->stat_data_writes * e_write) / 1000.0;
 }
 
+void memsys_print_energy(Memsys *sys)
+{
+  char   header[256];
+  double dcache_dyn, icache_dyn=0, l2cache_dyn=0, dram_dyn=0, dramcache_dyn=0;
+  double static_energy, total, edp, epi=0;
+  uns64  static_per_cycle = DCACHE_E_STATIC;
+
+  sprintf(header, "ENERGY");
+
+  dcache_dyn = memsys_cache_energy(sys->dcache, DCACHE_E_TAG, DCACHE_E_READ, DCACHE_E_WRITE);
+
+  if(SIM_MODE!=SIM_MODE_A){
+    DRAM  *dram = sys->dram;
+    uns64 act, pre;
+
+    if(SIM_MODE==SIM_MODE_C){
+      act = dram->stat_row_miss + dram->stat_row_empty;
+      // precharges: row conflicts, policy closes and rows closed by refresh
+      pre = dram->stat_row_miss + dram->stat_row_closes + dram->stat_refresh_closes;
+    }else{
+      // fixed latency DRAM: closed page, every access opens and closes a row
+      act = dram->stat_read_access + dram->stat_write_access;
+      pre = act;
+    }
+
+    icache_dyn  = memsys_cache_energy(sys->icache, ICACHE_E_TAG, ICACHE_E_READ, ICACHE_E_WRITE);
+    l2cache_dyn = memsys_cache_energy(sys->l2cache, L2CACHE_E_TAG, L2CACHE_E_READ, L2CACHE_E_WRITE);
+    dram_dyn    = (double)(act * DRAM_E_ACT + pre * DRAM_E_PRE +
+                           dram->stat_read_access * DRAM_E_RD_BURST +
+                           dram->stat_write_access * DRAM_E_WR_BURST) / 1000.0;
+
+    static_per_cycle += ICACHE_E_STATIC + L2CACHE_E_STATIC + DRAM_E_BACKGROUND;
+    if(sys->dramcache){
+      dramcache_dyn = (double)(sys->dramcache->stat_bursts * DRAMCACHE_E_BURST) / 1000.0;
+    }
+  }
+
+  static_energy = (double)(cycle_count * static_per_cycle) / 1000.0;
+  if(SIM_MODE!=SIM_MODE_A && DRAM_E_BACKGROUND > DRAM_E_PD_BACKGROUND){
+    // power-down cycles draw only the power-down background
+    static_energy -= (double)(sys->dram->stat_pd_cycles * (DRAM_E_BACKGROUND - DRAM_E_PD_BACKGROUND)) / 1000.0;
+  }
+  total = dcache_dyn + icache_dyn + l2cache_dyn + dram_dyn + dramcache_dyn + static_energy;
+  edp = total * (double)cycle_count;
+  if(inst_count){
+    epi = 1000.0 * total / (double)inst_count;
+  }
+
+  printf("\n");
+  printf("\n%s_DCACHE_DYN_NJ  \t\t : %14.3f",  header, dcache_dyn);
+  if(SIM_MODE!=SIM_MODE_A){
+    printf("\n%s_ICACHE_DYN_NJ  \t\t : %14.3f",  header, icache_dyn);
+    printf("\n%s_L2CACHE_DYN_NJ \t\t : %14.3f",  header, l2cache_dyn);
+    printf("\n%s_DRAM_DYN_NJ    \t\t : %14.3f",  header, dram_dyn);
+    if(sys->dramcache){
+      printf("\n%s_DRAMCACHE_DYN_NJ\t\t : %14.3f",  header, dramcache_dyn);
+    }
+  }
+  printf("\n%s_STATIC_NJ      \t\t : %14.3f",  header, static_energy);
+  printf("\n%s_TOTAL_NJ       \t\t : %14.3f",  header, total);
+  printf("\n%s_PER_INST_PJ    \t\t : %14.3f",  header, epi);
+  printf("\n%s_EDP_NJ_CYCLES  \t\t : %14.6e",  header, edp);
+  printf("\n");
+}
 
 ////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////
@@ -167,12 +772,84 @@ uns64 memsys_access_modeA(Memsys *sys, Addr lineaddr, Access_Type type){
 ////////////////////////////////////////////////////////////////////
 // --------------- DO NOT CHANGE THE CODE ABOVE THIS LINE ----------
 ////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////
+// The L2 line and sectors holding an L1 line. The L2 line may be
+// larger, so an L1 fill or writeback covers only part of it; with
+// sectors that part is the requested/dirty sectors, shifted to the
+// L1 line's offset in the L2 line.
+////////////////////////////////////////////////////////////////////
+
+static inline Addr memsys_L2_line(Memsys *sys, Addr l1_lineaddr, uns l1_shift){
+  return l1_lineaddr>>(sys->l2line_shift-l1_shift);
+}
+
+static inline uns64 memsys_L2_mask(Memsys *sys, Addr l1_lineaddr, uns l1_shift, uns64 l1_mask){
+  Addr offset;
+
+  if(sys->l2cache->sectors_per_line==1)
+    return sys->l2cache->sector_all;
+  offset=((l1_lineaddr<<l1_shift) & (L2CACHE_LINESIZE-1))>>sys->sector_shift;
+  return l1_mask<<offset;
+}
+
+////////////////////////////////////////////////////////////////////
+// L1 <-> L2 transfers, counted as traffic in L1 sectors: a fill of
+// the requested sectors, and a DCACHE write (writeback, write-through
+// or write-around) of the written ones. Writes are off the critical
+// path, their L2 delay is not returned.
+////////////////////////////////////////////////////////////////////
+
+static inline uns64 memsys_L1_bytes(uns l1_shift, uns64 l1_mask){
+  return (uns64)__builtin_popcountll(l1_mask)*(SECTOR_SIZE ? SECTOR_SIZE : 1ULL<<l1_shift);
+}
+
+static uns64 memsys_L1_fill(Memsys *sys, Addr l1_lineaddr, uns l1_shift, uns64 l1_mask){
+  sys->stat_l1_read_bytes+=memsys_L1_bytes(l1_shift, l1_mask);
+  return memsys_L2_access_sectors(sys, memsys_L2_line(sys,l1_lineaddr,l1_shift),
+                                  memsys_L2_mask(sys,l1_lineaddr,l1_shift,l1_mask), FALSE);
+}
+
+static void memsys_L1_write(Memsys *sys, Addr l1_lineaddr, uns64 l1_mask){
+  sys->stat_l1_write_bytes+=memsys_L1_bytes(sys->dline_shift, l1_mask);
+  memsys_L2_access_sectors(sys, memsys_L2_line(sys,l1_lineaddr,sys->dline_shift),
+                           memsys_L2_mask(sys,l1_lineaddr,sys->dline_shift,l1_mask), TRUE);
+}
+
+// write-through: the level keeps a clean copy of the line it wrote
+static inline void memsys_clean_line(Cache_Line *line){
+  line->dirty=FALSE;
+  line->sector_dirty=0;
+}
+
+////////////////////////////////////////////////////////////////////
+// DCACHE store miss under no-allocate or write-combining: no fill,
+// the store goes on to the L2 directly or through the buffer
+////////////////////////////////////////////////////////////////////
+
+static void memsys_dcache_write_around(Memsys *sys, Addr lineaddr, uns64 sector){
+  Addr  out_line;
+  uns64 out_mask;
+
+  sys->stat_dcache_writearounds++;
+  if(sys->dcache_wcb==NULL)
+  {
+      memsys_L1_write(sys, lineaddr, sector);
+  }
+  else if(wcb_write(sys->dcache_wcb, lineaddr, sector, &out_line, &out_mask))
+  {
+      memsys_L1_write(sys, out_line, out_mask);
+  }
+}
+
 uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type){
   uns64 delay=0;
   Flag access_dcache=FALSE;
   Flag access_icache=FALSE;
   uns mark_dirty=FALSE;
+  uns64 sector=1ULL<<sys->cur_sector;
 
+  sys->cur_type=type;
   if(type == ACCESS_TYPE_IFETCH){
     access_icache=TRUE;
     mark_dirty=FALSE;
@@ -188,32 +865,67 @@ uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type){
 
   if(access_icache)
   {
-      delay=ICACHE_HIT_LATENCY;
-      Flag hit=cache_access(sys->icache, lineaddr, FALSE);
+      if(sys->fetchbuf_valid && lineaddr==sys->fetchbuf_lineaddr &&
+         (sys->fetchbuf_line->sector_valid & sector))
+      {
+          // same line as the previous fetch: a hit, only bump LRU
+          cache_touch_line(sys->icache, sys->fetchbuf_line);
+          sys->stat_fetchbuf_hits++;
+          return cache_lookup_latency(sys->icache, ICACHE_HIT_LATENCY);
+      }
+      Flag hit=cache_access_sectors(sys->icache, lineaddr, sector, FALSE);
+      delay=cache_lookup_latency(sys->icache, ICACHE_HIT_LATENCY);
       if(hit==MISS)
       {
-          delay+=memsys_L2_access(sys,lineaddr,FALSE);
-          cache_install(sys->icache, lineaddr, mark_dirty);
+          delay+=memsys_L1_fill(sys, lineaddr, sys->iline_shift, sector);
+          cache_fill(sys->icache, lineaddr, sector, mark_dirty);
+      }
+      if(FETCHBUF_ENABLE)
+      {
+          sys->fetchbuf_valid=TRUE;
+          sys->fetchbuf_lineaddr=lineaddr;
+          sys->fetchbuf_line=sys->icache->last_touched_line;
       }
   }
   else if(access_dcache)
   {
-      delay=DCACHE_HIT_LATENCY;
-      Flag hit=cache_access(sys->dcache, lineaddr, mark_dirty);
+      Flag hit=cache_access_sectors(sys->dcache, lineaddr, sector, mark_dirty);
+      delay=cache_lookup_latency(sys->dcache, DCACHE_HIT_LATENCY);
+      if(hit==MISS && mark_dirty && DCACHE_WRITE_MISS!=WRITE_ALLOCATE)
+      {
+          memsys_dcache_write_around(sys, lineaddr, sector);
+          return delay;
+      }
       if(hit==MISS)
       {
-          delay+=memsys_L2_access(sys,lineaddr,FALSE);
-          cache_install(sys->dcache, lineaddr, mark_dirty);
+          uns64 buffered;
+
+          if(sys->prof)
+              profile_event(sys->prof, PROFILE_DCACHE_MISS, sys->cur_pc, lineaddr<<sys->dline_shift, 1);
+          // the fill must see stores still in the combining buffer
+          if(sys->dcache_wcb && wcb_take(sys->dcache_wcb, lineaddr, &buffered))
+              memsys_L1_write(sys, lineaddr, buffered);
+          delay+=memsys_L1_fill(sys, lineaddr, sys->dline_shift, sector);
+          cache_fill(sys->dcache, lineaddr, sector, mark_dirty);
           if(sys->dcache->last_evicted_line.dirty==TRUE && sys->dcache->last_evicted_line.valid==TRUE)
           {
               //int numberOfSets=log2(sys->dcache->num_sets);
               //int MSBs=get_bits(sys->dcache->last_evicted_line.tag, 64,(numberOfSets));
 
-              int dontCareDelay=memsys_L2_access(sys,sys->dcache->last_evicted_line.tag, TRUE);
+              // only the dirty sectors are written back, into part of a larger L2 line
+              sys->stat_dcache_writebacks++;
+              memsys_L1_write(sys, sys->dcache->last_evicted_line.tag,
+                              sys->dcache->last_evicted_line.sector_dirty);
               sys->dcache->last_evicted_line.dirty=FALSE;
               //sys->dcache->last_evicted_line.valid=FALSE;
           }
       }
+      if(mark_dirty && DCACHE_WRITE_POLICY==WRITE_THROUGH)
+      {
+          memsys_clean_line(sys->dcache->last_touched_line);
+          sys->stat_dcache_writethroughs++;
+          memsys_L1_write(sys, lineaddr, sector);
+      }
   }
   return delay;
 }
@@ -224,27 +936,341 @@ uns64 memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type){
 // ----- YOU NEED TO WRITE THIS FUNCTION AND UPDATE DELAY ----------
 /////////////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////////////
+// Below the L2: one DRAM access per sector in mask, or one access to
+// the DRAM cache when there is one
+/////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_dram_read(Memsys *sys, Addr lineaddr, uns64 mask){
+  uns64 delay=0;
+
+  if(sys->dramcache)
+  {
+      return dramcache_read(sys->dramcache, lineaddr, mask, sys->cur_pc);
+  }
+  while(mask)
+  {
+      delay+=dram_access(sys->dram,lineaddr, FALSE);
+      mask&=mask-1;
+  }
+  return delay;
+}
+
+static void memsys_dram_write(Memsys *sys, Addr lineaddr, uns64 mask){
+  if(sys->dramcache)
+  {
+      dramcache_write(sys->dramcache, lineaddr, mask);
+      return;
+  }
+  while(mask)
+  {
+      dram_access(sys->dram, lineaddr, TRUE);
+      mask&=mask-1;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Compressed L2 fill: the new line may displace several compressed
+// lines, each dirty one is written back to DRAM
+/////////////////////////////////////////////////////////////////////
+
+static void memsys_L2_install_compressed(Memsys *sys, Addr lineaddr, Flag is_writeback){
+  Cache *l2=sys->l2cache;
+  uns64 ii;
+
+  cache_install_compressed(l2, lineaddr, is_writeback, compress_line_size(sys->compress, lineaddr));
+  for(ii=0; ii<l2->comp_num_evicted; ii++)
+  {
+      if(l2->comp_evicted[ii].dirty)
+      {
+          memsys_dram_write(sys, l2->comp_evicted[ii].tag, 1);
+      }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Uncompressed L2 fill: a replaced line writes back only its dirty
+// sectors
+/////////////////////////////////////////////////////////////////////
+
+static void memsys_L2_install(Memsys *sys, Addr lineaddr, uns64 mask, Flag is_writeback){
+  cache_fill(sys->l2cache, lineaddr, mask, is_writeback);
+  if(sys->l2cache->last_evicted_line.dirty==TRUE)
+  {
+    uns64 dirty=sys->l2cache->last_evicted_line.sector_dirty;
+
+    //int numberOfSets=log2(sys->dcache->num_sets);
+    //int MSBs=get_bits(sys->dcache->last_evicted_line.tag, 64,(numberOfSets));
+    sys->l2cache->last_evicted_line.dirty=FALSE;
+    //sys->l2cache->last_evicted_line.valid=FALSE;
+    memsys_dram_write(sys, sys->l2cache->last_evicted_line.tag, dirty);
+  }
+}
+
 uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback){
-  uns64 delay = L2CACHE_HIT_LATENCY;
+  return memsys_L2_access_sectors(sys, lineaddr, sys->l2cache->sector_all, is_writeback);
+}
+
+/////////////////////////////////////////////////////////////////////
+// L2 lookup for the sectors in mask, filling on a miss (reads, and
+// writes under write-allocate). Missing sectors are read from DRAM
+// one sector at a time, and a replaced line writes back only its
+// dirty sectors, so DRAM traffic is in sector_size units.
+/////////////////////////////////////////////////////////////////////
+
+static uns64 memsys_L2_lookup(Memsys *sys, Addr lineaddr, uns64 mask, Flag is_writeback){
+  uns64 delay, buffered;
+
+  // the DRAM read must see writes still in the combining buffer
+  if(sys->l2_wcb && !is_writeback && wcb_take(sys->l2_wcb, lineaddr, &buffered))
+  {
+      memsys_dram_write(sys, lineaddr, buffered);
+  }
 
   //To get the delay of L2 MISS, you must use the dram_access() function
   //To perform writebacks to memory, you must use the dram_access() function
   //This will help us track your memory reads and memory writes
-  Flag hit=cache_access(sys->l2cache, lineaddr, is_writeback);
+  Flag hit=cache_access_sectors(sys->l2cache, lineaddr, mask, is_writeback);
+  delay=cache_lookup_latency(sys->l2cache, L2CACHE_HIT_LATENCY);
+  if(hit==HIT && sys->compress && sys->l2cache->last_touched_line->comp_size < L2CACHE_LINESIZE)
+  {
+      delay+=L2CACHE_DECOMP_LATENCY;
+      sys->compress->stat_decompress++;
+  }
+  if(hit==HIT && sys->reuse && !is_writeback)
+  {
+      reuse_hit(sys->reuse, sys->l2cache->last_touched_line);
+  }
   if(hit==MISS)
   {
-      delay+=dram_access(sys->dram,lineaddr, FALSE);
-      cache_install(sys->l2cache, lineaddr, is_writeback);
-      if(sys->l2cache->last_evicted_line.dirty==TRUE)
+      uns64 missing=sys->l2cache->last_missing_sectors;
+      Flag  new_line=!sys->l2cache->last_tag_hit;
+      Flag  dead=FALSE;
+      uns   sig=0;
+      uns64 dram_reads_before=sys->dram->stat_read_access;
+
+      // only demand fills of a new line are predicted (writebacks have no PC)
+      if(sys->reuse && new_line && !is_writeback)
+      {
+          reuse_miss(sys->reuse, lineaddr);
+          sig=reuse_sig(sys->reuse, sys->cur_pc);
+          dead=reuse_predict_dead(sys->reuse, sig);
+      }
+
+      delay+=memsys_dram_read(sys, lineaddr, missing);
+      if(sys->prof && !is_writeback)
+      {
+          // reads that reached DRAM: one per missing sector, none on a DRAM cache hit
+          uns64 dram_reads=sys->dram->stat_read_access-dram_reads_before;
+
+          profile_event(sys->prof, PROFILE_L2_MISS, sys->cur_pc, lineaddr<<sys->l2line_shift, 1);
+          if(dram_reads)
+          {
+              profile_event(sys->prof, PROFILE_DRAM_READ, sys->cur_pc, lineaddr<<sys->l2line_shift, dram_reads);
+          }
+      }
+      if(dead && L2CACHE_BYPASS)
+      {
+          // predicted dead: the data goes to the L1 only
+          reuse_bypass(sys->reuse, lineaddr, sig);
+          return delay;
+      }
+      sys->l2cache->insert_dead=dead;
+      if(sys->compress)
       {
-        //int numberOfSets=log2(sys->dcache->num_sets);
-        //int MSBs=get_bits(sys->dcache->last_evicted_line.tag, 64,(numberOfSets));
-        sys->l2cache->last_evicted_line.dirty=FALSE;
-        //sys->l2cache->last_evicted_line.valid=FALSE;
-        int dontCareDelay=dram_access(sys->dram,sys->l2cache->last_evicted_line.tag, TRUE);
+          memsys_L2_install_compressed(sys, lineaddr, is_writeback);
+      }
+      else
+      {
+          memsys_L2_install(sys, lineaddr, mask, is_writeback);
+      }
+      if(sys->reuse && new_line)
+      {
+          if(sys->l2cache->last_evicted_line.valid)
+              reuse_evict(sys->reuse, &sys->l2cache->last_evicted_line);
+          if(is_writeback)
+              reuse_fill_untracked(sys->reuse, sys->l2cache->last_touched_line);
+          else
+              reuse_fill(sys->reuse, sys->l2cache->last_touched_line, sig, dead);
+      }
+  }
+
+  return delay;
+}
+
+/////////////////////////////////////////////////////////////////////
+// L2 write under a write-through or non-allocating policy. A miss
+// that does not allocate goes to DRAM directly or through the
+// combining buffer, without reading the line.
+/////////////////////////////////////////////////////////////////////
 
+static uns64 memsys_L2_write(Memsys *sys, Addr lineaddr, uns64 mask){
+  Addr  out_line;
+  uns64 out_mask, delay;
+
+  if(L2CACHE_WRITE_MISS==WRITE_ALLOCATE)
+  {
+      delay=memsys_L2_lookup(sys, lineaddr, mask, TRUE);
+  }
+  else
+  {
+      Flag hit=cache_access_sectors(sys->l2cache, lineaddr, mask, TRUE);
+      delay=cache_lookup_latency(sys->l2cache, L2CACHE_HIT_LATENCY);
+      if(hit==MISS)
+      {
+          sys->stat_l2_writearounds++;
+          if(sys->l2_wcb==NULL)
+          {
+              memsys_dram_write(sys, lineaddr, mask);
+          }
+          else if(wcb_write(sys->l2_wcb, lineaddr, mask, &out_line, &out_mask))
+          {
+              memsys_dram_write(sys, out_line, out_mask);
+          }
+          return delay;
       }
   }
 
+  if(L2CACHE_WRITE_POLICY==WRITE_THROUGH)
+  {
+      memsys_clean_line(sys->l2cache->last_touched_line);
+      sys->stat_l2_writethroughs++;
+      memsys_dram_write(sys, lineaddr, mask);
+  }
+  return delay;
+}
+
+/////////////////////////////////////////////////////////////////////
+// L2 access for the sectors in mask: is_writeback marks a write from
+// the DCACHE (writeback, write-through or write-around)
+/////////////////////////////////////////////////////////////////////
+
+uns64   memsys_L2_access_sectors(Memsys *sys, Addr lineaddr, uns64 mask, Flag is_writeback){
+  uns64 delay;
+  L2_Stream_Rec rec;
+
+  if(sys->l2stream && !sys->l2stream->replay)
+  {
+      rec.lineaddr=lineaddr;
+      rec.mask=mask;
+      rec.type=sys->cur_type;
+      rec.is_writeback=is_writeback;
+      l2stream_record(sys->l2stream, cycle_count, &rec);
+  }
+
+  if(is_writeback && (L2CACHE_WRITE_POLICY!=WRITE_BACK || L2CACHE_WRITE_MISS!=WRITE_ALLOCATE))
+  {
+      delay=memsys_L2_write(sys, lineaddr, mask);
+  }
+  else
+  {
+      delay=memsys_L2_lookup(sys, lineaddr, mask, is_writeback);
+  }
+
+  if(sys->l2stream && !sys->l2stream->replay)
+  {
+      l2stream_delay(sys->l2stream, &rec, delay);
+  }
+
   return delay;
 }
+
+
+static void memsys_l1_energy_save(Cache *c, L2_Stream *s, uns idx)
+{
+  s->l1_tag_reads[idx]=c->stat_tag_reads;
+  s->l1_data_reads[idx]=c->stat_data_reads;
+  s->l1_data_writes[idx]=c->stat_data_writes;
+}
+
+static void memsys_l1_energy_restore(Cache *c, L2_Stream *s, uns idx)
+{
+  c->stat_tag_reads=s->l1_tag_reads[idx];
+  c->stat_data_reads=s->l1_data_reads[idx];
+  c->stat_data_writes=s->l1_data_writes[idx];
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// -l2replay: issue the recorded requests to the L2 at the cycle they
+// would have in a full run, then rebuild the run totals from the
+// trailer plus the L2 delays seen here
+/////////////////////////////////////////////////////////////////////
+
+void memsys_replay(Memsys *sys)
+{
+  L2_Stream    *s=sys->l2stream;
+  L2_Stream_Rec rec;
+  uns64         delay;
+
+  while(l2stream_next(s, &cycle_count, &rec))
+  {
+      delay=memsys_L2_access_sectors(sys, rec.lineaddr, rec.mask, rec.is_writeback);
+      l2stream_delay(s, &rec, delay);
+  }
+
+  cycle_count=l2stream_end_cycle(s);
+  inst_count=s->inst_count;
+
+  sys->stat_ifetch_access=s->access[ACCESS_TYPE_IFETCH];
+  sys->stat_load_access=s->access[ACCESS_TYPE_LOAD];
+  sys->stat_store_access=s->access[ACCESS_TYPE_STORE];
+  sys->stat_ifetch_delay=s->l1_delay[ACCESS_TYPE_IFETCH]+s->l2_delay[ACCESS_TYPE_IFETCH];
+  sys->stat_load_delay=s->l1_delay[ACCESS_TYPE_LOAD]+s->l2_delay[ACCESS_TYPE_LOAD];
+  sys->stat_store_delay=s->l1_delay[ACCESS_TYPE_STORE]+s->l2_delay[ACCESS_TYPE_STORE];
+  sys->stat_fetchbuf_hits=s->fetchbuf_hits;
+
+  // the L1s are not simulated, their energy comes from the recording
+  memsys_l1_energy_restore(sys->dcache, s, 0);
+  memsys_l1_energy_restore(sys->icache, s, 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////
+// End of the run: the combining buffers are drained and a recorded
+// L2 stream gets its trailer
+/////////////////////////////////////////////////////////////////////
+
+void memsys_finish(Memsys *sys)
+{
+  L2_Stream *s=sys->l2stream;
+  Addr       lineaddr;
+  uns64      mask;
+
+  // buffered writes still count as traffic
+  if(sys->dcache_wcb)
+  {
+      while(wcb_drain(sys->dcache_wcb, &lineaddr, &mask))
+      {
+          memsys_L1_write(sys, lineaddr, mask);
+      }
+  }
+  if(sys->l2_wcb)
+  {
+      while(wcb_drain(sys->l2_wcb, &lineaddr, &mask))
+      {
+          memsys_dram_write(sys, lineaddr, mask);
+      }
+  }
+
+  if(!s)
+  {
+      return;
+  }
+
+  if(!s->replay)
+  {
+      s->inst_count=inst_count;
+      s->end_l1_cycle=cycle_count-s->stall_committed-s->stall_pending;
+      s->access[ACCESS_TYPE_IFETCH]=sys->stat_ifetch_access;
+      s->access[ACCESS_TYPE_LOAD]=sys->stat_load_access;
+      s->access[ACCESS_TYPE_STORE]=sys->stat_store_access;
+      s->l1_delay[ACCESS_TYPE_IFETCH]=sys->stat_ifetch_delay-s->l2_delay[ACCESS_TYPE_IFETCH];
+      s->l1_delay[ACCESS_TYPE_LOAD]=sys->stat_load_delay-s->l2_delay[ACCESS_TYPE_LOAD];
+      s->l1_delay[ACCESS_TYPE_STORE]=sys->stat_store_delay-s->l2_delay[ACCESS_TYPE_STORE];
+      s->fetchbuf_hits=sys->stat_fetchbuf_hits;
+      memsys_l1_energy_save(sys->dcache, s, 0);
+      memsys_l1_energy_save(sys->icache, s, 1);
+  }
+  l2stream_close(s);
+}
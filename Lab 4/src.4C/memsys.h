@@ -4,6 +4,18 @@
 #include "types.h"
 #include "cache.h"
 #include "dram.h"
+#include "profile.h"
+#include "analyze.h"
+#include "compress.h"
+#include "tlb.h"
+#include "core.h"
+#include "l2stream.h"
+#include "wcb.h"
+#include "reuse.h"
+#include "dramcache.h"
+
+// records processed per pass inside memsys_access_batch
+#define MEMSYS_BATCH_CHUNK  256
 
 //////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////
@@ -15,6 +27,36 @@ struct Memsys {
   Cache *icache;  // For Part A,B
   Cache *l2cache; // For Part A,B
   DRAM  *dram;    // For Part A,B
+  Dram_Cache *dramcache; // between the L2 and DRAM, NULL unless -dramcache
+
+  // fetch-line buffer: most recent icache line, guaranteed resident
+  // until the next icache install (only ifetches touch the icache)
+  Flag        fetchbuf_valid;
+  Addr        fetchbuf_lineaddr;
+  Cache_Line *fetchbuf_line;
+
+  Profile    *prof;    // miss attribution, NULL unless -profile
+  Analyze    *analyze; // trace characterization, NULL unless -analyze
+  Compress   *compress; // compressed L2 line sizes, NULL unless -L2compress
+  Mmu        *mmu;     // TLBs and page walker, NULL unless -tlb
+  Core       *core;    // out-of-order timing, NULL for the 1 IPC pipeline
+  L2_Stream  *l2stream; // L2 request stream, NULL unless -l2record/-l2replay
+  Wcb        *dcache_wcb; // DCACHE write-combining buffer, NULL unless -Dwmiss 2
+  Wcb        *l2_wcb;  // L2 write-combining buffer, NULL unless -L2wmiss 2
+  Reuse_Pred *reuse;   // L2 reuse predictor, NULL unless -L2insert 3 or -L2bypass
+  Addr        cur_pc;  // inst_addr of the record being simulated
+  Access_Type cur_type; // access being simulated (for the L2 stream)
+
+  uns64       sector_size;      // bytes per DRAM transfer: last level sector or line
+  uns64       sectors_per_line; // of the last level (L2, or DCACHE in mode A)
+  uns         line_shift;       // log2(CACHE_LINESIZE), for -analyze
+  uns         sector_shift;     // log2(sector_size)
+  uns         dline_shift;      // log2 of the DCACHE, ICACHE and L2 line sizes
+  uns         iline_shift;
+  uns         l2line_shift;
+  uns64       dsector_mask;     // sectors per DCACHE/ICACHE line, minus 1
+  uns64       isector_mask;
+  uns         cur_sector;       // sector of the address being accessed
 
    // stats 
   uns64 stat_ifetch_access;
@@ -23,6 +65,16 @@ struct Memsys {
   uns64 stat_ifetch_delay;
   uns64 stat_load_delay;
   uns64 stat_store_delay;
+  uns64 stat_fetchbuf_hits;
+
+  // traffic between the levels (mode B/C)
+  uns64 stat_l1_read_bytes;        // ICACHE/DCACHE fills from the L2
+  uns64 stat_l1_write_bytes;       // DCACHE writes into the L2
+  uns64 stat_dcache_writebacks;    // DCACHE writes into the L2, by cause
+  uns64 stat_dcache_writethroughs;
+  uns64 stat_dcache_writearounds;  // store misses sent on without a fill
+  uns64 stat_l2_writethroughs;     // L2 writes passed on to DRAM, by cause
+  uns64 stat_l2_writearounds;
 };
 
 
@@ -32,14 +84,22 @@ struct Memsys {
 
 Memsys *memsys_new();
 void    memsys_print_stats(Memsys *sys);
+void    memsys_print_traffic(Memsys *sys, Flag print_l1);
+void    memsys_print_energy(Memsys *sys);
 
 uns64   memsys_access(Memsys *sys, Addr addr, Access_Type type);
+void    memsys_access_batch(Memsys *sys, Trace_Rec *recs, uns num_recs);
+void    memsys_retire(Memsys *sys, Trace_Rec *rec, uns64 ifetch_delay, uns64 ldst_delay);
 uns64   memsys_access_modeA(Memsys *sys, Addr lineaddr, Access_Type type);
 uns64   memsys_access_modeBC(Memsys *sys, Addr lineaddr, Access_Type type);
+uns64   memsys_translate(Memsys *sys, Addr addr, Access_Type type);
+void    memsys_replay(Memsys *sys);
+void    memsys_finish(Memsys *sys);
 
 
 // For mode B and mode C you must use this function to access L2 
 uns64   memsys_L2_access(Memsys *sys, Addr lineaddr, Flag is_writeback);
+uns64   memsys_L2_access_sectors(Memsys *sys, Addr lineaddr, uns64 mask, Flag is_writeback);
 
 ///////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,138 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "hash.h"
+
+static const char *profile_event_names[PROFILE_NUM_EVENTS] = {
+  "DCACHE_MISS", "L2_MISS", "DRAM_READ",
+};
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static void profile_table_init(Profile_Table *t, uns64 num_entries){
+  t->entries = (Profile_Entry *) calloc (num_entries, sizeof(Profile_Entry));
+  t->num_entries = num_entries;
+  t->num_used = 0;
+}
+
+static Profile_Entry *profile_table_probe(Profile_Table *t, Addr key){
+  uns64 mask = t->num_entries - 1;
+  uns64 idx = hash_mix(key) & mask;
+
+  while(t->entries[idx].valid && t->entries[idx].key != key){
+    idx = (idx + 1) & mask;
+  }
+  return &t->entries[idx];
+}
+
+static void profile_table_grow(Profile_Table *t){
+  Profile_Entry *old = t->entries;
+  uns64 old_num = t->num_entries;
+  uns64 ii;
+
+  profile_table_init(t, 2*old_num);
+  for(ii=0; ii<old_num; ii++){
+    if(old[ii].valid){
+      *profile_table_probe(t, old[ii].key) = old[ii];
+      t->num_used++;
+    }
+  }
+  free(old);
+}
+
+static Profile_Entry *profile_table_lookup(Profile_Table *t, Addr key){
+  Profile_Entry *e = profile_table_probe(t, key);
+
+  if(!e->valid){
+    if(2*(t->num_used+1) > t->num_entries){
+      profile_table_grow(t);
+      e = profile_table_probe(t, key);
+    }
+    e->valid = TRUE;
+    e->key = key;
+    t->num_used++;
+  }
+  return e;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Profile *profile_new(uns64 region_size, uns64 topn){
+  Profile *p = (Profile *) calloc (1, sizeof (Profile));
+
+  assert(region_size);
+  p->region_size = region_size;
+  p->topn = topn;
+  profile_table_init(&p->pc_table, PROFILE_INIT_ENTRIES);
+  profile_table_init(&p->region_table, PROFILE_INIT_ENTRIES);
+
+  return p;
+}
+
+void profile_event(Profile *p, Profile_Event event, Addr pc, Addr addr, uns64 count){
+  profile_table_lookup(&p->pc_table, pc)->count[event] += count;
+  profile_table_lookup(&p->region_table, addr/p->region_size)->count[event] += count;
+}
+
+void profile_stall(Profile *p, Addr pc, Addr addr, uns64 cycles){
+  profile_table_lookup(&p->pc_table, pc)->stall_cycles += cycles;
+  profile_table_lookup(&p->region_table, addr/p->region_size)->stall_cycles += cycles;
+}
+
+//////////////////////////////////////////////////////////////////
+// Print the top-N entries of each table, ordered by stall cycles
+// and then by DCACHE misses
+//////////////////////////////////////////////////////////////////
+
+static int profile_compare(const void *a, const void *b){
+  const Profile_Entry *ea = (const Profile_Entry *) a;
+  const Profile_Entry *eb = (const Profile_Entry *) b;
+
+  if(ea->stall_cycles != eb->stall_cycles){
+    return (ea->stall_cycles < eb->stall_cycles) ? 1 : -1;
+  }
+  if(ea->count[PROFILE_DCACHE_MISS] != eb->count[PROFILE_DCACHE_MISS]){
+    return (ea->count[PROFILE_DCACHE_MISS] < eb->count[PROFILE_DCACHE_MISS]) ? 1 : -1;
+  }
+  return (ea->key > eb->key) - (ea->key < eb->key);
+}
+
+static void profile_print_table(Profile_Table *t, char *header, uns64 key_scale, uns64 topn){
+  Profile_Entry *sorted = (Profile_Entry *) malloc (t->num_used * sizeof(Profile_Entry) + 1);
+  uns64 num=0, ii;
+  int   ev;
+
+  for(ii=0; ii<t->num_entries; ii++){
+    if(t->entries[ii].valid){
+      sorted[num++] = t->entries[ii];
+    }
+  }
+  qsort(sorted, num, sizeof(Profile_Entry), profile_compare);
+
+  printf("\n%s_ENTRIES      \t\t : %10llu", header, num);
+  printf("\n%s %18s %12s", header, "ADDR", "STALL");
+  for(ev=0; ev<PROFILE_NUM_EVENTS; ev++){
+    printf(" %12s", profile_event_names[ev]);
+  }
+
+  for(ii=0; ii<num && ii<topn; ii++){
+    printf("\n%s %#18llx %12llu", header, sorted[ii].key*key_scale, sorted[ii].stall_cycles);
+    for(ev=0; ev<PROFILE_NUM_EVENTS; ev++){
+      printf(" %12llu", sorted[ii].count[ev]);
+    }
+  }
+  printf("\n");
+
+  free(sorted);
+}
+
+void profile_print(Profile *p){
+  printf("\n");
+  profile_print_table(&p->pc_table, "PROFILE_PC", 1, p->topn);
+  profile_print_table(&p->region_table, "PROFILE_REGION", p->region_size, p->topn);
+}
@@ -0,0 +1,60 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+
+#define PROFILE_INIT_ENTRIES  4096 // initial hash table size (power of two)
+
+//////////////////////////////////////////////////////////////////
+// Miss attribution profiler: counts DCACHE/L2 misses, the DRAM reads
+// they issue and pipeline stall cycles per instruction PC and per
+// address region (-profregion bytes, e.g. 4096 for pages, 64 for lines).
+// Each table is an open addressing hash keyed by PC or region
+// number, grown by doubling at half load. Addresses are in bytes,
+// since the cache levels may use different line sizes.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Profile_Entry Profile_Entry;
+typedef struct Profile_Table Profile_Table;
+typedef struct Profile Profile;
+
+typedef enum Profile_Event_Enum {
+    PROFILE_DCACHE_MISS=0,
+    PROFILE_L2_MISS=1,
+    PROFILE_DRAM_READ=2,
+    PROFILE_NUM_EVENTS=3,
+} Profile_Event;
+
+
+struct Profile_Entry {
+  Flag   valid;
+  Addr   key;
+  uns64  count[PROFILE_NUM_EVENTS];
+  uns64  stall_cycles;
+};
+
+
+struct Profile_Table {
+  Profile_Entry *entries;
+  uns64          num_entries; // capacity, power of two
+  uns64          num_used;
+};
+
+
+struct Profile {
+  Profile_Table  pc_table;
+  Profile_Table  region_table;
+  uns64          region_size;   // bytes per region
+  uns64          topn;
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Profile *profile_new(uns64 region_size, uns64 topn);
+void     profile_event(Profile *p, Profile_Event event, Addr pc, Addr addr, uns64 count);
+void     profile_stall(Profile *p, Addr pc, Addr addr, uns64 cycles);
+void     profile_print(Profile *p);
+
+#endif // PROFILE_H
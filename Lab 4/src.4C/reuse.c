@@ -0,0 +1,158 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reuse.h"
+#include "stats.h"
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Reuse_Pred *reuse_new(uns64 num_entries, uns64 shadow_size){
+  Reuse_Pred *r = (Reuse_Pred *) calloc (1, sizeof (Reuse_Pred));
+  uns64 ii;
+
+  assert(num_entries && !(num_entries & (num_entries-1)));
+  assert(shadow_size && !(shadow_size & (shadow_size-1)));
+  r->num_entries = num_entries;
+  r->shadow_size = shadow_size;
+  r->ctr         = (uns8 *) calloc (num_entries, sizeof(uns8));
+  r->shadow_line = (Addr *) calloc (shadow_size, sizeof(Addr));
+  r->shadow_sig  = (uns *)  calloc (shadow_size, sizeof(uns));
+
+  for(ii=0; ii<num_entries; ii++){
+    r->ctr[ii] = REUSE_CTR_INIT;
+  }
+
+  return r;
+}
+
+uns reuse_sig(Reuse_Pred *r, Addr pc){
+  return (uns)(((pc>>2) ^ (pc>>13)) & (r->num_entries-1));
+}
+
+Flag reuse_predict_dead(Reuse_Pred *r, uns sig){
+  return r->ctr[sig]==0;
+}
+
+static uns64 reuse_shadow_index(Reuse_Pred *r, Addr lineaddr){
+  return (lineaddr ^ (lineaddr>>17)) & (r->shadow_size-1);
+}
+
+////////////////////////////////////////////////////////////////////
+// A new line in the cache: remember its signature and prediction.
+// Lines filled by writebacks have no demand PC and are not tracked.
+////////////////////////////////////////////////////////////////////
+
+void reuse_fill(Reuse_Pred *r, Cache_Line *line, uns sig, Flag pred_dead){
+  line->reuse_sig = sig;
+  line->pred_dead = pred_dead;
+  line->reused = FALSE;
+  r->stat_fills++;
+  r->stat_pred_dead += pred_dead;
+}
+
+void reuse_fill_untracked(Reuse_Pred *r, Cache_Line *line){
+  (void)r;
+  line->pred_dead = FALSE;
+  line->reused = TRUE;
+}
+
+void reuse_hit(Reuse_Pred *r, Cache_Line *line){
+  if(line->reused){
+    return;
+  }
+
+  line->reused = TRUE;
+  if(r->ctr[line->reuse_sig] < REUSE_CTR_MAX){
+    r->ctr[line->reuse_sig]++;
+  }
+  if(line->pred_dead){
+    r->stat_dead_reused++;
+  }
+}
+
+void reuse_evict(Reuse_Pred *r, Cache_Line *line){
+  if(line->reused){
+    return;
+  }
+
+  if(r->ctr[line->reuse_sig] > 0){
+    r->ctr[line->reuse_sig]--;
+  }
+  if(line->pred_dead){
+    r->stat_dead_unused++;
+  }else{
+    r->stat_live_unused++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+// Bypass bookkeeping: a demand miss to a line bypassed earlier and
+// still in the shadow table would have hit had it been inserted
+////////////////////////////////////////////////////////////////////
+
+void reuse_bypass(Reuse_Pred *r, Addr lineaddr, uns sig){
+  uns64 idx = reuse_shadow_index(r, lineaddr);
+
+  r->shadow_line[idx] = lineaddr;
+  r->shadow_sig[idx]  = sig;
+  r->stat_bypass++;
+}
+
+void reuse_miss(Reuse_Pred *r, Addr lineaddr){
+  uns64 idx = reuse_shadow_index(r, lineaddr);
+  uns   sig;
+
+  if(r->shadow_line[idx] != lineaddr || lineaddr == 0){
+    return;
+  }
+
+  sig = r->shadow_sig[idx];
+  if(r->ctr[sig] < REUSE_CTR_MAX){
+    r->ctr[sig]++;
+  }
+  r->shadow_line[idx] = 0;
+  r->stat_bypass_reused++;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void reuse_register_stats(Reuse_Pred *r){
+  stats_register("REUSE", "FILLS",         &r->stat_fills);
+  stats_register("REUSE", "PRED_DEAD",     &r->stat_pred_dead);
+  stats_register("REUSE", "DEAD_UNUSED",   &r->stat_dead_unused);
+  stats_register("REUSE", "DEAD_REUSED",   &r->stat_dead_reused);
+  stats_register("REUSE", "LIVE_UNUSED",   &r->stat_live_unused);
+  stats_register("REUSE", "BYPASS",        &r->stat_bypass);
+  stats_register("REUSE", "BYPASS_REUSED", &r->stat_bypass_reused);
+}
+
+void reuse_print(Reuse_Pred *r){
+  char   header[256];
+  double dead_acc = 0, bypass_acc = 0;
+  uns64  dead_done = r->stat_dead_unused + r->stat_dead_reused;
+
+  sprintf(header, "REUSE");
+
+  // accuracy of the dead predictions that have been resolved
+  if(dead_done){
+    dead_acc = (double)(r->stat_dead_unused)/(double)(dead_done);
+  }
+  if(r->stat_bypass){
+    bypass_acc = 1.0 - (double)(r->stat_bypass_reused)/(double)(r->stat_bypass);
+  }
+
+  printf("\n");
+  printf("\n%s_FILLS          \t\t : %10llu", header, r->stat_fills);
+  printf("\n%s_PRED_DEAD      \t\t : %10llu", header, r->stat_pred_dead);
+  printf("\n%s_DEAD_UNUSED    \t\t : %10llu", header, r->stat_dead_unused);
+  printf("\n%s_DEAD_REUSED    \t\t : %10llu", header, r->stat_dead_reused);
+  printf("\n%s_LIVE_UNUSED    \t\t : %10llu", header, r->stat_live_unused);
+  printf("\n%s_DEAD_ACCURACY  \t\t : %10.3f", header, dead_acc);
+  printf("\n%s_BYPASS         \t\t : %10llu", header, r->stat_bypass);
+  printf("\n%s_BYPASS_REUSED  \t\t : %10llu", header, r->stat_bypass_reused);
+  printf("\n%s_BYPASS_ACCURACY\t\t : %10.3f", header, bypass_acc);
+  printf("\n");
+}
@@ -0,0 +1,60 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+#include "types.h"
+#include "cache.h"
+
+#define REUSE_CTR_MAX   3   // 2-bit saturating reuse counters
+#define REUSE_CTR_INIT  1   // weakly live
+
+//////////////////////////////////////////////////////////////////
+// PC-based reuse (dead-block) predictor for L2 fills, in the style
+// of SHiP: a table of saturating counters indexed by a hash of the
+// PC whose miss brought the line in. A demand hit on the line
+// counts its signature up, an eviction with no hit counts it down,
+// and a fill whose counter is 0 is predicted dead. Dead fills are
+// inserted at LRU (-L2insert 3) or bypass the L2 (-L2bypass 1).
+//
+// A bypassed line is not in the cache, so the predictor keeps its
+// address in a direct-mapped shadow table about the size of the L2.
+// A later miss to a shadowed line means the bypass was wrong: the
+// counter is trained back up and the bypass counted as reused.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Reuse_Pred Reuse_Pred;
+
+
+struct Reuse_Pred {
+  uns64  num_entries;      // counters, a power of two
+  uns8  *ctr;
+  uns64  shadow_size;      // power of two
+  Addr  *shadow_line;      // recently bypassed lines (0: empty)
+  uns   *shadow_sig;
+
+  // stats
+  uns64  stat_fills;        // fills with a prediction
+  uns64  stat_pred_dead;
+  uns64  stat_dead_unused;  // predicted dead, evicted with no hit
+  uns64  stat_dead_reused;  // predicted dead, hit before eviction
+  uns64  stat_live_unused;  // predicted live, evicted with no hit
+  uns64  stat_bypass;
+  uns64  stat_bypass_reused; // bypassed, then missed again while shadowed
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Reuse_Pred *reuse_new(uns64 num_entries, uns64 shadow_size);
+uns     reuse_sig(Reuse_Pred *r, Addr pc);
+Flag    reuse_predict_dead(Reuse_Pred *r, uns sig);
+void    reuse_fill(Reuse_Pred *r, Cache_Line *line, uns sig, Flag pred_dead);
+void    reuse_fill_untracked(Reuse_Pred *r, Cache_Line *line);
+void    reuse_hit(Reuse_Pred *r, Cache_Line *line);
+void    reuse_evict(Reuse_Pred *r, Cache_Line *line);
+void    reuse_bypass(Reuse_Pred *r, Addr lineaddr, uns sig);
+void    reuse_miss(Reuse_Pred *r, Addr lineaddr);
+void    reuse_register_stats(Reuse_Pred *r);
+void    reuse_print(Reuse_Pred *r);
+
+#endif // REUSE_H
@@ -10,12 +10,20 @@
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "types.h"
 #include "memsys.h"
+#include "config.h"
+#include "stats.h"
+#include "tracegen.h"
 
-#define PRINT_DOTS   1
-#define DOT_INTERVAL 100000
+#define PROGRESS_CHECK_INTERVAL 100000 // instructions between progress clock checks
+
+#define TRACE_REC_BYTES   9     // 4B inst_addr, 1B inst_type, 4B ldst_addr
+#define TRACE64_REC_BYTES 17    // -trace64: 8B inst_addr, 1B inst_type, 8B ldst_addr
+#define TRACE_BATCH_SIZE  4000  // records per memsys_access_batch call (divides PROGRESS_CHECK_INTERVAL)
 
 /***************************************************************************
  * Globals 
@@ -23,35 +31,188 @@
 
 MODE        SIM_MODE        = SIM_MODE_A;
 uns64       CACHE_LINESIZE  = 64;
+uns64       SECTOR_SIZE     = 0;  // bytes per sector, 0: unsectored (one per line)
 uns64       REPL_POLICY     = 0; // 0:LRU 1:RAND
 
 uns64       DCACHE_SIZE     = 32*1024; 
 uns64       DCACHE_ASSOC    = 8; 
+uns64       DCACHE_LINESIZE = 0;  // 0: CACHE_LINESIZE
 
 uns64       ICACHE_SIZE     = 32*1024; 
 uns64       ICACHE_ASSOC    = 8; 
+uns64       ICACHE_LINESIZE = 0;
 
 uns64       L2CACHE_SIZE    = 512*1024; 
 uns64       L2CACHE_ASSOC   = 16; 
+uns64       L2CACHE_LINESIZE = 0; // at least the L1 line sizes
+
+uns64       DCACHE_HIT_LATENCY  = 1;
+uns64       ICACHE_HIT_LATENCY  = 1;
+uns64       L2CACHE_HIT_LATENCY = 10;
+
+uns64       DCACHE_INDEX        = 0;    // set index 0:modulo 1:XOR 2:prime 3:skewed
+uns64       ICACHE_INDEX        = 0;
+uns64       L2CACHE_INDEX       = 0;
+uns64       SET_STATS           = 0;    // 1: print the set occupancy distribution
+
+uns64       DCACHE_WRITE_POLICY = 0;    // write hits 0:write-back 1:write-through
+uns64       DCACHE_WRITE_MISS   = 0;    // write misses 0:allocate 1:no-allocate 2:combining buffer
+uns64       L2CACHE_WRITE_POLICY = 0;
+uns64       L2CACHE_WRITE_MISS  = 0;
+uns64       WCB_ENTRIES         = 8;    // lines per write-combining buffer
+
+uns64       L2CACHE_INSERT      = 0;    // L2 insertion 0:MRU 1:LIP 2:BIP 3:PC reuse predictor
+uns64       L2CACHE_BYPASS      = 0;    // 1: L2 fills predicted dead bypass the L2
+uns64       BIP_THROTTLE        = 32;   // BIP: 1 in N fills at MRU
+uns64       REUSE_ENTRIES       = 16384; // reuse predictor counters
+
+uns64       L2CACHE_COMPRESS        = 0;    // 1: compressed L2, up to 2x lines per set
+uns64       L2CACHE_DECOMP_LATENCY  = 2;    // extra cycles on a hit to a compressed line
+char        *COMPRESS_MAP_FILE      = NULL; // measured compressed line sizes
+
+uns64       DCACHE_WAYPRED          = 0;  // 0:none 1:MRU 2:PC-indexed
+uns64       DCACHE_WAYPRED_LATENCY  = 1;  // hit latency when the predicted way hits
+uns64       DCACHE_WAYPRED_PENALTY  = 1;  // extra cycles on a misprediction
+uns64       ICACHE_WAYPRED          = 0;
+uns64       ICACHE_WAYPRED_LATENCY  = 1;
+uns64       ICACHE_WAYPRED_PENALTY  = 1;
+uns64       L2CACHE_WAYPRED         = 0;
+uns64       L2CACHE_WAYPRED_LATENCY = 10;
+uns64       L2CACHE_WAYPRED_PENALTY = 2;
+
+uns64       DCACHE_E_TAG        = 1;    // energy in pJ: tag way probed
+uns64       DCACHE_E_READ       = 5;    // data way read
+uns64       DCACHE_E_WRITE      = 6;    // data way written (write hit or fill)
+uns64       DCACHE_E_STATIC     = 2;    // leakage per cycle
+uns64       ICACHE_E_TAG        = 1;
+uns64       ICACHE_E_READ       = 5;
+uns64       ICACHE_E_WRITE      = 6;
+uns64       ICACHE_E_STATIC     = 2;
+uns64       L2CACHE_E_TAG       = 3;
+uns64       L2CACHE_E_READ      = 25;
+uns64       L2CACHE_E_WRITE     = 30;
+uns64       L2CACHE_E_STATIC    = 15;
+uns64       DRAM_E_ACT          = 1200; // row activate
+uns64       DRAM_E_PRE          = 600;  // row precharge
+uns64       DRAM_E_RD_BURST     = 1800; // one line read burst
+uns64       DRAM_E_WR_BURST     = 1900; // one line write burst
+uns64       DRAM_E_BACKGROUND   = 80;   // background/refresh per cycle
+uns64       DRAM_E_PD_BACKGROUND = 20;  // background per cycle in power-down
+
+uns64       CORE_OOO            = 0;    // 0: 1 IPC blocking pipeline 1: out-of-order core
+uns64       ROB_SIZE            = 128;
+uns64       CORE_WIDTH          = 4;    // dispatch and retire width
+uns64       LQ_SIZE             = 48;
+uns64       SQ_SIZE             = 32;
+uns64       CORE_MSHRS          = 0;    // L1D MSHRs for load misses, 0: unlimited
+
+uns64       TLB_ENABLE          = 0;    // 1: ITLB/DTLB, STLB and page walker
+uns64       ITLB_ENTRIES        = 64;
+uns64       ITLB_ASSOC          = 4;
+uns64       DTLB_ENTRIES        = 64;
+uns64       DTLB_ASSOC          = 4;
+uns64       STLB_ENTRIES        = 1536;
+uns64       STLB_ASSOC          = 12;
+uns64       STLB_LATENCY        = 7;    // extra cycles on an L1 TLB miss
+uns64       HUGEPAGE_PCT        = 0;    // percent of 2 MB regions on huge pages
+
+uns64       DRAM_BANKS          = 16;
+uns64       ROWBUF_SIZE         = 1024;
+uns64       DRAM_LATENCY_FIXED  = 100;  // Part B
+uns64       DRAM_T_ACT          = 45;   // Part C
+uns64       DRAM_T_CAS          = 45;
+uns64       DRAM_T_PRE          = 45;
+uns64       DRAM_T_BUS          = 10;
+uns64       DRAM_T_REFI         = 0;    // refresh interval, 0: no refresh
+uns64       DRAM_T_RFC          = 1050; // all-bank refresh time
+uns64       DRAM_T_RRD          = 0;    // min cycles between activates, 0: off
+uns64       DRAM_T_FAW          = 0;    // window holding at most 4 activates, 0: off
+uns64       DRAM_PD_THRESHOLD   = 0;    // idle cycles before power-down, 0: never
+uns64       DRAM_T_XP           = 20;   // power-down exit latency
+uns64       DRAM_ROW_POLICY     = 0;    // 0:open 1:closed 2:close after timeout 3:predictive
+uns64       DRAM_ROW_TIMEOUT    = 200;  // idle cycles before a timeout precharge
+uns64       DRAM_BANK_STATS     = 0;    // 1: print row buffer outcomes per bank
+
+uns64       DRAMCACHE_ORG         = 0;    // DRAM cache 0:off 1:Alloy 2:Footprint
+uns64       DRAMCACHE_SIZE        = 1024*1024*1024;
+uns64       DRAMCACHE_ASSOC       = 4;    // Footprint pages per set
+uns64       DRAMCACHE_PAGE_SIZE   = 2048; // Footprint page bytes
+uns64       DRAMCACHE_LATENCY     = 60;   // data access, without channel waits
+uns64       DRAMCACHE_TAG_LATENCY = 5;    // Footprint SRAM tag lookup
+uns64       DRAMCACHE_CHANNELS    = 8;
+uns64       DRAMCACHE_T_BURST     = 4;    // channel cycles per line moved
+uns64       DRAMCACHE_PREDICT     = 1;    // Alloy: 1: MAP-I miss predictor
+uns64       DRAMCACHE_MAP_ENTRIES = 256;
+uns64       DRAMCACHE_FHT_ENTRIES = 16384; // Footprint history signatures
+uns64       DRAMCACHE_E_BURST     = 400;  // pJ per line moved
+
+uns64       PROGRESS_SECS   = 10;   // seconds between progress lines, 0: off
+char        *PROGRESS_FILE  = NULL; // progress lines go here, stderr if NULL
+
+uns64       TRACE64         = 0; // 1: trace records carry 64-bit addresses
+char        *L2STREAM_RECORD_FILE = NULL; // write the L2 request stream here
+char        *L2STREAM_REPLAY_FILE = NULL; // simulate only the L2/DRAM from this stream
+uns64       TRACE_BATCH     = 1; // 0: per-record memsys_access 1: memsys_access_batch
+uns64       FETCHBUF_ENABLE = 1; // skip icache set scan for repeat fetches to the same line
+uns64       FETCHBUF_STATS  = 0; // 1: print the fetch-line buffer hits (always in -stats)
+uns64       CACHE_KERNELS   = 1; // fixed-geometry cache kernels for the common configs
+uns64       CACHE_SET_ALLOC = 1; // cache sets 0:calloc 1:lazy compact mapping 2:huge pages
+
+uns64       SYNTH_INSTS       = 0;   // -synth: generate this many instructions, no trace file
+char        *SYNTH_OUT        = NULL; // write the synthetic trace here and exit
+uns64       SYNTH_SEED        = 1;
+uns64       SYNTH_MEM_PCT     = 30;  // static instructions that are loads/stores
+uns64       SYNTH_STORE_PCT   = 30;  // loads/stores that are stores
+uns64       SYNTH_STREAM_PCT  = 40;  // loads/stores per address model, sum to 100
+uns64       SYNTH_CHASE_PCT   = 20;
+uns64       SYNTH_ZIPF_PCT    = 40;
+uns64       SYNTH_STREAM_SIZE = 16*1024*1024;
+uns64       SYNTH_STRIDE      = 8;
+uns64       SYNTH_CHASE_SIZE  = 4*1024*1024;
+uns64       SYNTH_ZIPF_SIZE   = 64*1024*1024;
+uns64       SYNTH_ZIPF_THETA  = 99;  // Zipf skew in hundredths, 0: uniform
+uns64       SYNTH_CODE_SIZE   = 64*1024;
+
+char        *STATS_FILE     = NULL; // final stats as JSON (*.json) or CSV
+char        *INTERVAL_FILE  = NULL; // per-interval stats as JSON lines (*.json) or CSV
+uns64       STATS_INTERVAL  = 0;    // instructions per interval sample, 0: off
+
+uns64       PROFILE_TOPN    = 0;    // per-PC/region miss profile entries to print, 0: off
+uns64       PROFILE_REGION  = 4096; // bytes per profiled address region
+
+uns64       ANALYZE_SAMPLE  = 0;       // trace characterization, sample 1 in N lines, 0: off
+uns64       WS_INTERVAL     = 1000000; // instructions per working-set interval
 
 
 /***************************************************************************************
  * Functions
  ***************************************************************************************/
-void print_dots(void);
+void progress_init(void);
+void progress_check(void);
+void progress_done(void);
+uns64 gzip_uncompressed_size(const char *filename);
 void die_usage();
 void die_message(const char * msg);
 void get_params(int argc, char** argv);
 void print_stats();
+Flag sim_step_record();
+Flag sim_step_batch(uns64 max_recs);
 
 /***************************************************************************************
  * Globals
  ***************************************************************************************/
 FILE        *trfile;
+Tracegen    *tracegen;           // -synth: records come from here instead of trfile
 Memsys      *memsys; 
 uns64       cycle_count;
 uns64       inst_count; 
-uns64       last_printdot_inst;
+uns64       last_progress_inst;
+uns64       trace_total_bytes;   // uncompressed trace size, 0 if unknown
+FILE        *progress_fp;
+double      progress_start;
+double      progress_last;
+uns64       last_interval_inst;
+uns64       last_ws_inst;
 
 
 /***************************************************************************************
@@ -59,74 +220,191 @@ uns64       last_printdot_inst;
  ***************************************************************************************/
 int main(int argc, char** argv)
 {
-    Flag tmp, done=0;
+    Flag done=0;
 
     srand(42);
     get_params(argc, argv);
+
+    if(SYNTH_OUT){
+      uns64 num_recs = tracegen_write(tracegen, SYNTH_OUT, TRACE64);
+      printf("Wrote %llu synthetic trace records to %s\n", num_recs, SYNTH_OUT);
+      return 0;
+    }
+
     memsys = memsys_new();
-    print_dots();
+    stats_register("", "CYCLES", &cycle_count);
+    stats_register_ratio("", "CPI", &cycle_count, &inst_count);
+    if(INTERVAL_FILE && STATS_INTERVAL){
+      stats_interval_open(INTERVAL_FILE);
+    }
+    progress_init();
+
+    if(L2STREAM_REPLAY_FILE){
+      memsys_replay(memsys);
+      done = TRUE;
+    }
 
     //--------------------------------------------------------------------
     // -- Iterate through the traces until done
     //--------------------------------------------------------------------
 
     while( !done ){
-      Addr inst_addr=0, ldst_addr=0;
-      Inst_Type inst_type=0; 
+
+      if(TRACE_BATCH){
+	// stop the block at the next progress/interval boundary
+	uns64 max_recs = PROGRESS_CHECK_INTERVAL - (inst_count - last_progress_inst);
+	if(STATS_INTERVAL && STATS_INTERVAL - (inst_count - last_interval_inst) < max_recs){
+	  max_recs = STATS_INTERVAL - (inst_count - last_interval_inst);
+	}
+	if(ANALYZE_SAMPLE && WS_INTERVAL - (inst_count - last_ws_inst) < max_recs){
+	  max_recs = WS_INTERVAL - (inst_count - last_ws_inst);
+	}
+	done = sim_step_batch(max_recs);
+      }else{
+	done = sim_step_record();
+      }
+
+      //------ check for progress report -------------------
+      if (inst_count - last_progress_inst >= PROGRESS_CHECK_INTERVAL){
+	    progress_check();
+      }
+
+      //------ interval stats sample -----------------------
+      if (STATS_INTERVAL && inst_count - last_interval_inst >= STATS_INTERVAL){
+	    stats_interval_sample(inst_count);
+	    last_interval_inst = inst_count;
+      }
+
+      //------ working-set interval for the trace analysis --
+      if (ANALYZE_SAMPLE && inst_count - last_ws_inst >= WS_INTERVAL){
+	    analyze_interval_end(memsys->analyze, inst_count);
+	    last_ws_inst = inst_count;
+      }
+      
+    }
+
+    if (STATS_INTERVAL && inst_count > last_interval_inst){
+      stats_interval_sample(inst_count);
+    }
+    stats_interval_close();
+
+    if(memsys->core){
+      core_finish(memsys->core);
+    }
+    memsys_finish(memsys);
+
+    if (ANALYZE_SAMPLE && inst_count > last_ws_inst){
+      analyze_interval_end(memsys->analyze, inst_count);
+    }
+
+    progress_done();
+    print_stats();
+    if(STATS_FILE){
+      stats_dump(STATS_FILE);
+    }
+    return 0;
+
+}
+
+//--------------------------------------------------------------------
+// -- Simulate one trace record with per-access memsys calls
+// -- (kept for debugging, selected with -batch 0)
+//--------------------------------------------------------------------
+
+Flag sim_step_record(){
+      Flag tmp;
+      Trace_Rec rec={0};
       uns ifetch_delay=0, ld_delay=0, st_delay=0;
+      uns addr_bytes=TRACE64 ? 8 : 4;
 
       //------ read the trace record for each instruction ----------------      
 
-      tmp = fread (&inst_addr, 4, 1, trfile);
-      tmp = fread (&inst_type, 1, 1, trfile);
-      tmp = fread (&ldst_addr, 4, 1, trfile);
+      if(tracegen){
+	if(!tracegen_fill(tracegen, &rec, 1)){
+	  return TRUE;
+	}
+      }else{
+	tmp = fread (&rec.inst_addr, addr_bytes, 1, trfile);
+	tmp = fread (&rec.inst_type, 1, 1, trfile);
+	tmp = fread (&rec.ldst_addr, addr_bytes, 1, trfile);
+	(void) tmp;
 
-      if(feof(trfile)){
-	done=TRUE;
-	break;
+	if(feof(trfile)){
+	  return TRUE;
+	}
       }
 
       //------ access the memory system ----------------------------------
 
-      ifetch_delay = memsys_access(memsys, inst_addr, ACCESS_TYPE_IFETCH);
+      memsys->cur_pc = rec.inst_addr;
+      ifetch_delay = memsys_access(memsys, rec.inst_addr, ACCESS_TYPE_IFETCH);
 
-      if(inst_type==INST_TYPE_LOAD){
-	ld_delay = memsys_access(memsys, ldst_addr, ACCESS_TYPE_LOAD);
+      if(rec.inst_type==INST_TYPE_LOAD){
+	ld_delay = memsys_access(memsys, rec.ldst_addr, ACCESS_TYPE_LOAD);
       }
 
-      if(inst_type==INST_TYPE_STORE){
-	st_delay = memsys_access(memsys, ldst_addr, ACCESS_TYPE_STORE);
+      if(rec.inst_type==INST_TYPE_STORE){
+	st_delay = memsys_access(memsys, rec.ldst_addr, ACCESS_TYPE_STORE);
       }
      
 
       //------ update the stats  ------------------------------------------
 
       inst_count++;
-      cycle_count++; //assume 1 IPC for perfect pipeline
+      memsys_retire(memsys, &rec, ifetch_delay,
+		    (rec.inst_type==INST_TYPE_LOAD) ? ld_delay : st_delay);
 
-      if(ifetch_delay>1){
-	cycle_count += (ifetch_delay-1);
-      }
+      return FALSE;
+}
 
-      if(ld_delay>1){
-	cycle_count += (ld_delay-1);
-      }
+//--------------------------------------------------------------------
+// -- Read a block of trace records and hand it to memsys in one call
+// -- memsys_access_batch advances cycle_count with the same memsys_retire
+//--------------------------------------------------------------------
+
+Flag sim_step_batch(uns64 max_recs){
+      static uns8      buf[TRACE_BATCH_SIZE * TRACE64_REC_BYTES];
+      static Trace_Rec recs[TRACE_BATCH_SIZE];
+      size_t num_recs, ii;
 
-      if(st_delay>1){
-	// with store buffers, store misses do not stall the pipeline
+      if(max_recs > TRACE_BATCH_SIZE){
+	max_recs = TRACE_BATCH_SIZE;
       }
 
+      if(tracegen){
+	num_recs = tracegen_fill(tracegen, recs, max_recs);
+      }else if(TRACE64){
+	num_recs = fread (buf, TRACE64_REC_BYTES, max_recs, trfile);
+
+	for(ii=0; ii<num_recs; ii++){
+	  uns8  *rec=&buf[ii*TRACE64_REC_BYTES];
+	  uns64 inst_addr, ldst_addr;
 
-      //------ check for heartbeat -------------------------
-      if (inst_count - last_printdot_inst >= DOT_INTERVAL){
-	    print_dots();
+	  memcpy(&inst_addr, rec, 8);
+	  memcpy(&ldst_addr, rec+9, 8);
+	  recs[ii].inst_addr = inst_addr;
+	  recs[ii].inst_type = rec[8];
+	  recs[ii].ldst_addr = ldst_addr;
+	}
+      }else{
+	num_recs = fread (buf, TRACE_REC_BYTES, max_recs, trfile);
+
+	for(ii=0; ii<num_recs; ii++){
+	  uns8  *rec=&buf[ii*TRACE_REC_BYTES];
+	  uns32 inst_addr, ldst_addr;
+
+	  memcpy(&inst_addr, rec, 4);
+	  memcpy(&ldst_addr, rec+5, 4);
+	  recs[ii].inst_addr = inst_addr;
+	  recs[ii].inst_type = rec[4];
+	  recs[ii].ldst_addr = ldst_addr;
+	}
       }
-      
-    }
 
-    print_stats();
-    return 0;
+      memsys_access_batch(memsys, recs, num_recs);
+      inst_count += num_recs;
 
+      return (num_recs < max_recs);
 }
 
 //--------------------------------------------------------------------
@@ -145,31 +423,107 @@ void print_stats(){
 }
 
 //--------------------------------------------------------------------
-// -- Print Hearbeats 
+// -- Progress report: the main loop calls progress_check every
+// -- PROGRESS_CHECK_INTERVAL instructions, and a line is written to
+// -- stderr (or -progressfile) only once PROGRESS_SECS have passed,
+// -- so stdout keeps just the stats.
 //--------------------------------------------------------------------
 
+static double progress_now(){
+  struct timespec ts;
 
-void print_dots(){
-  uns LINE_INTERVAL = 50 *  DOT_INTERVAL;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+}
 
-  last_printdot_inst = inst_count;
+void progress_init(){
+  last_progress_inst = inst_count;
+  progress_start = progress_now();
+  progress_last = progress_start;
 
-  if(!PRINT_DOTS){
-      return;
+  if(!PROGRESS_SECS){
+    return;
   }
 
-  if (inst_count % LINE_INTERVAL ==0){
-	printf("\n%4llu M\t", inst_count/1000000);
-	fflush(stdout);
-    }
-    else{
-	printf(".");
-	fflush(stdout);
-    }
-    
+  progress_fp = stderr;
+  if(PROGRESS_FILE && (progress_fp = fopen(PROGRESS_FILE, "w")) == NULL){
+    die_message("Unable to open the progress file");
+  }
+}
+
+static void progress_print(double now){
+  double elapsed = now - progress_start;
+  double ips = (elapsed > 0) ? (double)inst_count/elapsed : 0;
+  uns64  total_inst = trace_total_bytes / (TRACE64 ? TRACE64_REC_BYTES : TRACE_REC_BYTES);
+
+  fprintf(progress_fp, "[%8.1f s] %10.2f M inst %8.3f MIPS  CPI %8.3f",
+	  elapsed, (double)inst_count/1e6, ips/1e6,
+	  inst_count ? (double)cycle_count/(double)inst_count : 0.0);
+
+  if(total_inst > inst_count && ips > 0){
+    uns64 eta = (uns64)((double)(total_inst - inst_count)/ips);
+    fprintf(progress_fp, "  %5.1f%%  ETA %02llu:%02llu:%02llu",
+	    100.0*(double)inst_count/(double)total_inst, eta/3600, (eta/60)%60, eta%60);
+  }
+  fprintf(progress_fp, "\n");
+  fflush(progress_fp);
+}
+
+void progress_check(){
+  double now;
+
+  last_progress_inst = inst_count;
+  if(!progress_fp){
+    return;
+  }
+
+  now = progress_now();
+  if(now - progress_last >= (double)PROGRESS_SECS){
+    progress_last = now;
+    progress_print(now);
+  }
+}
+
+void progress_done(){
+  if(!progress_fp){
+    return;
+  }
+
+  progress_print(progress_now());
+  if(progress_fp != stderr){
+    fclose(progress_fp);
+  }
+  progress_fp = NULL;
 }
 
 
+//--------------------------------------------------------------------
+// -- Uncompressed size of a .gz trace for the progress ETA: the
+// -- gzip trailer keeps it modulo 2^32, so add 4 GB until it is at
+// -- least the compressed size (exact for traces under 4 GB)
+//--------------------------------------------------------------------
+
+uns64 gzip_uncompressed_size(const char *filename){
+  FILE  *fp;
+  uns8   trailer[4];
+  uns64  size = 0, compressed;
+
+  if((fp = fopen(filename, "rb")) == NULL){
+    return 0;
+  }
+  if(fseeko(fp, 0, SEEK_END) == 0 && (compressed = ftello(fp)) >= 18 &&
+     fseeko(fp, -4, SEEK_END) == 0 && fread(trailer, 1, 4, fp) == 4){
+    size = (uns64)trailer[0] | ((uns64)trailer[1] << 8) |
+           ((uns64)trailer[2] << 16) | ((uns64)trailer[3] << 24);
+    while(size < compressed){
+      size += 1ULL << 32;
+    }
+  }
+  fclose(fp);
+
+  return size;
+}
+
 //--------------------------------------------------------------------
 // -- Usage Menu
 //--------------------------------------------------------------------
@@ -179,10 +533,72 @@ void die_usage() {
     printf("   Options\n");
     printf("      -mode            <num>    Set mode of the simulator[1:PartA, 2:PartB, 3:PartC]  (Default: 1)\n");
     printf("      -linesize        <num>    Set cache linesize for all caches (Default:64)\n");
+    printf("      -Dlinesize       <num>    Linesize of the DCACHE, overrides -linesize\n");
+    printf("      -Ilinesize       <num>    Linesize of the ICACHE, overrides -linesize\n");
+    printf("      -L2linesize      <num>    Linesize of the L2, at least the L1 linesizes, overrides -linesize\n");
     printf("      -repl            <num>    Set replacement policy for all caches [0:LRU,1:RND] (Default:0)\n");
+    printf("      -sectorsize      <num>    Sector size in bytes for all caches, 0 for whole lines (Default:0)\n");
     printf("      -DsizeKB         <num>    Set capacity in KB of the the Level 1 DCACHE (Default:32 KB)\n");
     printf("      -Dassoc          <num>    Set associativity of the the Level 1 DCACHE (Default:8)\n");
+    printf("      -IsizeKB         <num>    Set capacity in KB of the the Level 1 ICACHE (Default:32 KB)\n");
+    printf("      -Iassoc          <num>    Set associativity of the the Level 1 ICACHE (Default:8)\n");
     printf("      -L2sizeKB        <num>    Set capacity in KB of the unified Level 2 cache (Default: 512 KB)\n");
+    printf("      -L2assoc         <num>    Set associativity of the unified Level 2 cache (Default:16)\n");
+    printf("      -Dlatency        <num>    Hit latency of the DCACHE (Default:1)\n");
+    printf("      -Ilatency        <num>    Hit latency of the ICACHE (Default:1)\n");
+    printf("      -L2latency       <num>    Hit latency of the L2 (Default:10)\n");
+    printf("      -waypred         <num>    Way prediction for all caches [0:none,1:MRU,2:PC] (Default:0)\n");
+    printf("      -Dindex          <num>    DCACHE set index [0:modulo,1:XOR,2:prime,3:skewed] (Default:0)\n");
+    printf("      -Iindex          <num>    ICACHE set index [0:modulo,1:XOR,2:prime,3:skewed] (Default:0)\n");
+    printf("      -L2index         <num>    L2 set index [0:modulo,1:XOR,2:prime,3:skewed] (Default:0)\n");
+    printf("      -setstats        <num>    Print the set occupancy distribution [0:off,1:on] (Default:0)\n");
+    printf("      -Dwrite          <num>    DCACHE write hits [0:write-back,1:write-through] (Default:0)\n");
+    printf("      -Dwmiss          <num>    DCACHE write misses [0:allocate,1:no-allocate,2:combining buffer] (Default:0)\n");
+    printf("      -L2write         <num>    L2 write hits [0:write-back,1:write-through] (Default:0)\n");
+    printf("      -L2wmiss         <num>    L2 write misses [0:allocate,1:no-allocate,2:combining buffer] (Default:0)\n");
+    printf("      -wcb             <num>    Lines per write-combining buffer (Default:8)\n");
+    printf("      -L2insert        <num>    L2 insertion [0:MRU,1:LIP,2:BIP,3:PC reuse predictor] (Default:0)\n");
+    printf("      -L2bypass        <num>    Bypass the L2 on fills predicted dead [0:off,1:on] (Default:0)\n");
+    printf("      -bipthrottle     <num>    BIP inserts 1 in <num> fills at MRU (Default:32)\n");
+    printf("      -reusesize       <num>    Reuse predictor counters, a power of two (Default:16384)\n");
+    printf("      -rowpolicy       <num>    DRAM row buffer [0:open,1:closed,2:timeout,3:predictive] (Default:0)\n");
+    printf("      -rowtimeout      <num>    Idle cycles before a timeout precharge (Default:200)\n");
+    printf("      -bankstats       <num>    Print row buffer hits/misses/empties per bank [0:off,1:on] (Default:0)\n");
+    printf("      -dramcache       <num>    DRAM cache between the L2 and DRAM [0:off,1:Alloy,2:Footprint] (Default:0)\n");
+    printf("      -dramcacheMB     <num>    Capacity in MB of the DRAM cache (Default:1024)\n");
+    printf("      -dramcachepred   <num>    Alloy MAP-I miss predictor [0:off,1:on] (Default:1)\n");
+    printf("      -L2compress      <num>    Compressed L2 cache [0:off,1:on] (Default:0)\n");
+    printf("      -L2decomp        <num>    Decompression latency of a compressed L2 hit (Default:2)\n");
+    printf("      -compmap         <file>   Compressed line sizes (<address> <bytes> per line) for -L2compress\n");
+    printf("      -config          <file>   Read parameters from an INI file (read first: command line options override it)\n");
+    printf("      -stats           <file>   Write all stats to a file, JSON if it ends in .json else CSV\n");
+    printf("      -interval        <num>    Sample stats every <num> instructions into the -intervalfile\n");
+    printf("      -intervalfile    <file>   Interval time series, JSON lines if it ends in .json else CSV\n");
+    printf("      -profile         <num>    Attribute misses/stalls to PCs and regions, print top <num> (Default:0, off)\n");
+    printf("      -profregion      <num>    Region size in bytes for the profiler (Default:4096)\n");
+    printf("      -analyze         <num>    Characterize the trace, sampling 1 in <num> lines (Default:0, off)\n");
+    printf("      -wsinterval      <num>    Instructions per working-set interval for -analyze (Default:1000000)\n");
+    printf("      -ooo             <num>    Out-of-order core timing instead of 1 IPC [0:off,1:on] (Default:0)\n");
+    printf("      -rob             <num>    ROB entries for -ooo (Default:128)\n");
+    printf("      -width           <num>    Dispatch/retire width for -ooo (Default:4)\n");
+    printf("      -lq              <num>    Load queue entries for -ooo (Default:48)\n");
+    printf("      -sq              <num>    Store queue entries for -ooo (Default:32)\n");
+    printf("      -mshrs           <num>    L1D MSHRs for load misses with -ooo, 0 for unlimited (Default:0)\n");
+    printf("      -progress        <num>    Seconds between progress lines on stderr, 0 for none (Default:10)\n");
+    printf("      -progressfile    <file>   Write the progress lines to a file instead of stderr\n");
+    printf("      -trace64         <num>    Trace records have 64-bit addresses [0:32-bit,1:64-bit] (Default:0)\n");
+    printf("      -tlb             <num>    Model ITLB/DTLB, STLB and page walks [0:off,1:on] (Default:0)\n");
+    printf("      -hugepages       <num>    Percent of 2 MB regions mapped with huge pages, for -tlb (Default:0)\n");
+    printf("      -l2record        <file>   Also write the L2 request stream (L1 misses, writebacks, walks) to a file\n");
+    printf("      -l2replay        <file>   Simulate only the L2 and DRAM from a recorded stream, no trace_file\n");
+    printf("      -batch           <num>    Feed memsys in blocks of trace records [0:per-record,1:batched] (Default:1)\n");
+    printf("      -fetchbuf        <num>    Enable the icache fetch-line buffer [0:off,1:on] (Default:1)\n");
+    printf("      -fetchbufstats   <num>    Print the fetch-line buffer hits [0:off,1:on] (Default:0)\n");
+    printf("      -kernels         <num>    Specialized cache kernels for common geometries [0:generic,1:on] (Default:1)\n");
+    printf("      -setalloc        <num>    Host memory for cache sets [0:calloc,1:lazy,2:huge pages] (Default:1)\n");
+    printf("      -synth           <num>    Simulate <num> instructions of the [synth] workload model, no trace_file\n");
+    printf("      -synthseed       <num>    Random seed of the synthetic workload (Default:1)\n");
+    printf("      -synthout        <file>   Write the synthetic trace to a file (gzip if *.gz) and exit\n");
 
     exit(0);
 }
@@ -210,6 +626,16 @@ void get_params(int argc, char** argv){
     die_usage();
   }
 
+    //--------------------------------------------------------------------
+    // -- Load -config files first, so every other option overrides them
+    //--------------------------------------------------------------------
+    for ( ii = 1; ii < argc - 1; ii++) {
+	if (!strcmp(argv[ii], "-config")) {
+	    config_load(argv[ii+1]);
+	    ii += 1;
+	}
+    }
+
     //--------------------------------------------------------------------
     // -- Get command line options
     //--------------------------------------------------------------------    
@@ -242,7 +668,7 @@ void get_params(int argc, char** argv){
 
 	    else if (!strcmp(argv[ii], "-DsizeKB")) {
 		if (ii < argc - 1) {		  
-		    DCACHE_SIZE = atoi(argv[ii+1])*1024;
+		    DCACHE_SIZE = atoll(argv[ii+1])*1024;
 		    ii += 1;
 		}
 	    }
@@ -256,7 +682,440 @@ void get_params(int argc, char** argv){
 
 	    else if (!strcmp(argv[ii], "-L2sizeKB")) {
 		if (ii < argc - 1) {		  
-		    L2CACHE_SIZE = atoi(argv[ii+1])*1024;
+		    L2CACHE_SIZE = atoll(argv[ii+1])*1024;
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-IsizeKB")) {
+		if (ii < argc - 1) {		  
+		    ICACHE_SIZE = atoll(argv[ii+1])*1024;
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Iassoc")) {
+		if (ii < argc - 1) {		  
+		    ICACHE_ASSOC = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2assoc")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_ASSOC = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Dlinesize")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_LINESIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Ilinesize")) {
+		if (ii < argc - 1) {		  
+		    ICACHE_LINESIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2linesize")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_LINESIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Dlatency")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_HIT_LATENCY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Ilatency")) {
+		if (ii < argc - 1) {		  
+		    ICACHE_HIT_LATENCY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2latency")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_HIT_LATENCY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-waypred")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_WAYPRED = ICACHE_WAYPRED = L2CACHE_WAYPRED = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-config")) {
+		if (ii < argc - 1) {		  
+		    ii += 1; // already loaded above
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-stats")) {
+		if (ii < argc - 1) {		  
+		    STATS_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-interval")) {
+		if (ii < argc - 1) {		  
+		    STATS_INTERVAL = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-intervalfile")) {
+		if (ii < argc - 1) {		  
+		    INTERVAL_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-profile")) {
+		if (ii < argc - 1) {		  
+		    PROFILE_TOPN = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-profregion")) {
+		if (ii < argc - 1) {		  
+		    PROFILE_REGION = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-analyze")) {
+		if (ii < argc - 1) {		  
+		    ANALYZE_SAMPLE = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-wsinterval")) {
+		if (ii < argc - 1) {		  
+		    WS_INTERVAL = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Dindex")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_INDEX = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Iindex")) {
+		if (ii < argc - 1) {		  
+		    ICACHE_INDEX = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2index")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_INDEX = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-setstats")) {
+		if (ii < argc - 1) {		  
+		    SET_STATS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Dwrite")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_WRITE_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-Dwmiss")) {
+		if (ii < argc - 1) {		  
+		    DCACHE_WRITE_MISS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2write")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_WRITE_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2wmiss")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_WRITE_MISS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-wcb")) {
+		if (ii < argc - 1) {		  
+		    WCB_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2insert")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_INSERT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2bypass")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_BYPASS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-bipthrottle")) {
+		if (ii < argc - 1) {		  
+		    BIP_THROTTLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-reusesize")) {
+		if (ii < argc - 1) {		  
+		    REUSE_ENTRIES = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-rowpolicy")) {
+		if (ii < argc - 1) {		  
+		    DRAM_ROW_POLICY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-rowtimeout")) {
+		if (ii < argc - 1) {		  
+		    DRAM_ROW_TIMEOUT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-bankstats")) {
+		if (ii < argc - 1) {		  
+		    DRAM_BANK_STATS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramcache")) {
+		if (ii < argc - 1) {
+		    DRAMCACHE_ORG = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramcacheMB")) {
+		if (ii < argc - 1) {
+		    DRAMCACHE_SIZE = atoll(argv[ii+1])*1024*1024;
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-dramcachepred")) {
+		if (ii < argc - 1) {
+		    DRAMCACHE_PREDICT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2compress")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_COMPRESS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-L2decomp")) {
+		if (ii < argc - 1) {		  
+		    L2CACHE_DECOMP_LATENCY = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-compmap")) {
+		if (ii < argc - 1) {		  
+		    COMPRESS_MAP_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-sectorsize")) {
+		if (ii < argc - 1) {		  
+		    SECTOR_SIZE = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-ooo")) {
+		if (ii < argc - 1) {		  
+		    CORE_OOO = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-rob")) {
+		if (ii < argc - 1) {		  
+		    ROB_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-width")) {
+		if (ii < argc - 1) {		  
+		    CORE_WIDTH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-lq")) {
+		if (ii < argc - 1) {		  
+		    LQ_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-sq")) {
+		if (ii < argc - 1) {		  
+		    SQ_SIZE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-mshrs")) {
+		if (ii < argc - 1) {		  
+		    CORE_MSHRS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-progress")) {
+		if (ii < argc - 1) {		  
+		    PROGRESS_SECS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-progressfile")) {
+		if (ii < argc - 1) {		  
+		    PROGRESS_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-trace64")) {
+		if (ii < argc - 1) {		  
+		    TRACE64 = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-tlb")) {
+		if (ii < argc - 1) {		  
+		    TLB_ENABLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-hugepages")) {
+		if (ii < argc - 1) {		  
+		    HUGEPAGE_PCT = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-l2record")) {
+		if (ii < argc - 1) {		  
+		    L2STREAM_RECORD_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-l2replay")) {
+		if (ii < argc - 1) {		  
+		    L2STREAM_REPLAY_FILE = argv[ii+1];
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-batch")) {
+		if (ii < argc - 1) {		  
+		    TRACE_BATCH = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-fetchbuf")) {
+		if (ii < argc - 1) {		  
+		    FETCHBUF_ENABLE = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-fetchbufstats")) {
+		if (ii < argc - 1) {		  
+		    FETCHBUF_STATS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-kernels")) {
+		if (ii < argc - 1) {		  
+		    CACHE_KERNELS = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-setalloc")) {
+		if (ii < argc - 1) {
+		    CACHE_SET_ALLOC = atoi(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-synth")) {
+		if (ii < argc - 1) {
+		    SYNTH_INSTS = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-synthseed")) {
+		if (ii < argc - 1) {
+		    SYNTH_SEED = atoll(argv[ii+1]);
+		    ii += 1;
+		}
+	    }
+
+	    else if (!strcmp(argv[ii], "-synthout")) {
+		if (ii < argc - 1) {
+		    SYNTH_OUT = argv[ii+1];
 		    ii += 1;
 		}
 	    }
@@ -281,16 +1140,75 @@ void get_params(int argc, char** argv){
     //--------------------------------------------------------------------
     // Error checking
     //--------------------------------------------------------------------
-    if (!got_trace_filename) {
+    if (SYNTH_OUT && !SYNTH_INSTS) {
+	die_message("-synthout needs -synth");
+    }
+
+    if (!got_trace_filename && !L2STREAM_REPLAY_FILE && !SYNTH_INSTS) {
 	die_message("Must provide at least one trace file");
     }
 
+    if (SYNTH_INSTS && (got_trace_filename || L2STREAM_REPLAY_FILE)) {
+	die_message("-synth generates the trace, drop the trace_file and -l2replay");
+    }
+
+    config_validate();
+
+    if (STATS_INTERVAL && !INTERVAL_FILE) {
+	die_message("-interval needs an -intervalfile");
+    }
+
+    if (ANALYZE_SAMPLE && !WS_INTERVAL) {
+	die_message("-wsinterval must be at least 1");
+    }
+
+    if (L2STREAM_RECORD_FILE || L2STREAM_REPLAY_FILE) {
+	if (SIM_MODE == SIM_MODE_A || CORE_OOO) {
+	    die_message("-l2record/-l2replay need mode 2 or 3 and the 1 IPC pipeline");
+	}
+	if (L2STREAM_RECORD_FILE && L2STREAM_REPLAY_FILE) {
+	    die_message("-l2record and -l2replay cannot be used together");
+	}
+    }
+
+    if (L2STREAM_REPLAY_FILE) {
+	if (STATS_INTERVAL || ANALYZE_SAMPLE || PROFILE_TOPN || L2CACHE_WAYPRED == WAYPRED_PC ||
+	    L2CACHE_INSERT == INSERT_PRED || L2CACHE_BYPASS ||
+	    (DRAMCACHE_ORG && (DRAMCACHE_PREDICT || DRAMCACHE_ORG == DRAMCACHE_FOOTPRINT))) {
+	    die_message("-l2replay has no instructions or PCs, drop -interval, -analyze, -profile, PC way prediction, the reuse predictor, the Alloy MAP-I predictor and the Footprint DRAM cache");
+	}
+	// the trace is not read
+	return;
+    }
+
+    if (SYNTH_INSTS) {
+	tracegen = tracegen_new();
+	trace_total_bytes = SYNTH_INSTS * (TRACE64 ? TRACE64_REC_BYTES : TRACE_REC_BYTES);
+	return;
+    }
+
 
     //--------------------------------------------------------------------
     // -- Open the trace file
     //--------------------------------------------------------------------
 
-    char  command_string[256];
+    size_t len = strlen(trace_filename);
+    if (len < 3 || strcmp(trace_filename + len - 3, ".gz")) {
+      // already decompressed (e.g. shared by sweep.sh in /dev/shm)
+      if ((trfile = fopen(trace_filename, "rb")) == NULL){
+	die_message("Unable to open the trace file");
+      }
+      printf("Opened uncompressed file: %s \n", trace_filename);
+      struct stat st;
+      if (fstat(fileno(trfile), &st) == 0){
+	trace_total_bytes = st.st_size;
+      }
+      return;
+    }
+
+    trace_total_bytes = gzip_uncompressed_size(trace_filename);
+
+    char  command_string[1100];
     sprintf(command_string,"gunzip -c %s", trace_filename);
     if ((trfile = popen(command_string, "r")) == NULL){
       printf("Command string is %s\n", command_string);
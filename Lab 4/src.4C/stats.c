@@ -0,0 +1,191 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+extern uns64 inst_count;
+
+void die_message(const char * msg);
+
+static Stat_Entry  stat_entries[MAX_STATS];
+static uns         num_stat_entries;
+
+static Stat_Ratio  stat_ratios[MAX_STAT_RATIOS];
+static uns         num_stat_ratios;
+
+static FILE       *interval_fp;
+static Flag        interval_json;
+static uns64       interval_rows;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static void stats_make_name(char *dst, const char *header, const char *name){
+  if(header && header[0]){
+    snprintf(dst, STAT_NAME_LEN, "%s_%s", header, name);
+  }else{
+    snprintf(dst, STAT_NAME_LEN, "%s", name);
+  }
+}
+
+static Flag stats_is_json(const char *filename){
+  size_t len = strlen(filename);
+  return (len >= 5 && !strcmp(filename + len - 5, ".json"));
+}
+
+static double stats_ratio(uns64 num, uns64 den){
+  if(den == 0){
+    return 0;
+  }
+  return (double)num/(double)den;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void stats_register(const char *header, const char *name, uns64 *counter){
+  Stat_Entry *e;
+
+  if(num_stat_entries >= MAX_STATS){
+    die_message("Too many stats registered, increase MAX_STATS in stats.h");
+  }
+
+  e = &stat_entries[num_stat_entries++];
+  stats_make_name(e->name, header, name);
+  e->counter = counter;
+  e->last_value = *counter;
+}
+
+void stats_register_ratio(const char *header, const char *name, uns64 *num, uns64 *den){
+  Stat_Ratio *r;
+
+  if(num_stat_ratios >= MAX_STAT_RATIOS){
+    die_message("Too many stat ratios registered, increase MAX_STAT_RATIOS in stats.h");
+  }
+
+  r = &stat_ratios[num_stat_ratios++];
+  stats_make_name(r->name, header, name);
+  r->num = num;
+  r->den = den;
+  r->last_num = *num;
+  r->last_den = *den;
+}
+
+//////////////////////////////////////////////////////////////////
+// Print one record: INST, every ratio, every counter. With
+// use_delta the values cover only the period since the last sample.
+//////////////////////////////////////////////////////////////////
+
+static void stats_print_header(FILE *fp){
+  uns ii;
+
+  fprintf(fp, "INST");
+  for(ii=0; ii<num_stat_ratios; ii++){
+    fprintf(fp, ",%s", stat_ratios[ii].name);
+  }
+  for(ii=0; ii<num_stat_entries; ii++){
+    fprintf(fp, ",%s", stat_entries[ii].name);
+  }
+  fprintf(fp, "\n");
+}
+
+static void stats_print_record(FILE *fp, Flag json, uns64 inst, Flag use_delta){
+  const char *sep = json ? ", " : ",";
+  uns ii;
+
+  if(json){
+    fprintf(fp, "{\"INST\": %llu", inst);
+  }else{
+    fprintf(fp, "%llu", inst);
+  }
+
+  for(ii=0; ii<num_stat_ratios; ii++){
+    Stat_Ratio *r = &stat_ratios[ii];
+    uns64 num = *r->num - (use_delta ? r->last_num : 0);
+    uns64 den = *r->den - (use_delta ? r->last_den : 0);
+
+    if(json){
+      fprintf(fp, "%s\"%s\": %.6f", sep, r->name, stats_ratio(num, den));
+    }else{
+      fprintf(fp, "%s%.6f", sep, stats_ratio(num, den));
+    }
+  }
+
+  for(ii=0; ii<num_stat_entries; ii++){
+    Stat_Entry *e = &stat_entries[ii];
+    uns64 value = *e->counter - (use_delta ? e->last_value : 0);
+
+    if(json){
+      fprintf(fp, "%s\"%s\": %llu", sep, e->name, value);
+    }else{
+      fprintf(fp, "%s%llu", sep, value);
+    }
+  }
+
+  fprintf(fp, json ? "}\n" : "\n");
+}
+
+//////////////////////////////////////////////////////////////////
+// Dump the final totals of every registered stat
+//////////////////////////////////////////////////////////////////
+
+void stats_dump(const char *filename){
+  FILE *fp;
+  Flag  json = stats_is_json(filename);
+
+  if((fp = fopen(filename, "w")) == NULL){
+    die_message("Unable to open the stats file");
+  }
+
+  if(!json){
+    stats_print_header(fp);
+  }
+  stats_print_record(fp, json, inst_count, FALSE);
+
+  fclose(fp);
+}
+
+//////////////////////////////////////////////////////////////////
+// Interval time series: one record per sample holding the change
+// of every stat since the previous sample (INST is the instruction
+// count at the end of the interval)
+//////////////////////////////////////////////////////////////////
+
+void stats_interval_open(const char *filename){
+  if((interval_fp = fopen(filename, "w")) == NULL){
+    die_message("Unable to open the interval stats file");
+  }
+  interval_json = stats_is_json(filename);
+  interval_rows = 0;
+}
+
+void stats_interval_sample(uns64 inst){
+  uns ii;
+
+  if(!interval_fp){
+    return;
+  }
+
+  if(!interval_json && interval_rows == 0){
+    stats_print_header(interval_fp);
+  }
+  stats_print_record(interval_fp, interval_json, inst, TRUE);
+  interval_rows++;
+
+  for(ii=0; ii<num_stat_ratios; ii++){
+    stat_ratios[ii].last_num = *stat_ratios[ii].num;
+    stat_ratios[ii].last_den = *stat_ratios[ii].den;
+  }
+  for(ii=0; ii<num_stat_entries; ii++){
+    stat_entries[ii].last_value = *stat_entries[ii].counter;
+  }
+}
+
+void stats_interval_close(void){
+  if(interval_fp){
+    fclose(interval_fp);
+    interval_fp = NULL;
+  }
+}
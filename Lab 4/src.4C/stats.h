@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+#define MAX_STATS          1024
+#define MAX_STAT_RATIOS    64
+#define STAT_NAME_LEN      64
+
+//////////////////////////////////////////////////////////////////
+// Registry of the simulator counters, for machine readable output.
+// Modules register pointers to their stat_* fields once at init;
+// the counters are only read when dumping, so the hot paths are
+// unchanged. Ratios (CPI, miss rates, ...) are computed from two
+// registered counters, both for the totals and for each interval.
+//
+// Output format follows the file name: *.json gives JSON, anything
+// else gives CSV (a header row, then one row per dump/interval).
+//////////////////////////////////////////////////////////////////
+
+typedef struct Stat_Entry Stat_Entry;
+typedef struct Stat_Ratio Stat_Ratio;
+
+struct Stat_Entry {
+  char    name[STAT_NAME_LEN];
+  uns64  *counter;
+  uns64   last_value; // value at the previous interval sample
+};
+
+struct Stat_Ratio {
+  char    name[STAT_NAME_LEN];
+  uns64  *num;
+  uns64  *den;
+  uns64   last_num;
+  uns64   last_den;
+};
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void    stats_register(const char *header, const char *name, uns64 *counter);
+void    stats_register_ratio(const char *header, const char *name, uns64 *num, uns64 *den);
+void    stats_dump(const char *filename);
+
+void    stats_interval_open(const char *filename);
+void    stats_interval_sample(uns64 inst);
+void    stats_interval_close(void);
+
+#endif // STATS_H
@@ -0,0 +1,110 @@
+#!/bin/bash
+######################################################################################
+# Design-space sweep: runs every point of the grid
+#     trace x L2 size x L2 assoc x repl x DRAM policy (mode 2: fixed, mode 3: rowbuf)
+# on a pool of worker processes and collects all the stats into one CSV file.
+#
+# Each trace is decompressed once into shared memory (/dev/shm) and every
+# simulation of that trace reads the same copy from the page cache.
+# Each run writes its progress (rate, CPI, ETA) to a .progress file next
+# to its .res file, in a directory named after the -o file with .res for
+# .csv; watch the default sweep with: tail -n1 ../results/sweep.res/*.progress
+#
+# Usage: ./sweep.sh [options]
+#     -t "<traces>"     trace names in ../traces/ (Default: "bzip2 lbm mcf")
+#     -s "<sizes>"      L2 sizes in KB            (Default: "512 1024")
+#     -a "<assocs>"     L2 associativities        (Default: "16")
+#     -r "<repls>"      replacement policies      (Default: "0")
+#     -m "<modes>"      DRAM policy / sim mode    (Default: "2 3")
+#     -x "<args>"       extra arguments passed to every ./sim run, ahead of
+#                       the grid flags so the swept values always win
+#                       (e.g. over the same keys in a -x "-config f.ini")
+#     -j <num>          number of workers         (Default: number of cores)
+#     -o <file>         output CSV                (Default: ../results/sweep.csv)
+######################################################################################
+
+TRACES="bzip2 lbm mcf"
+L2SIZES="512 1024"
+L2ASSOCS="16"
+REPLS="0"
+MODES="2 3"
+EXTRA=""
+JOBS=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 1)
+OUTCSV="../results/sweep.csv"
+TRACEDIR="../traces"
+
+while getopts "t:s:a:r:m:x:j:o:h" opt; do
+  case $opt in
+    t) TRACES=$OPTARG ;;
+    s) L2SIZES=$OPTARG ;;
+    a) L2ASSOCS=$OPTARG ;;
+    r) REPLS=$OPTARG ;;
+    m) MODES=$OPTARG ;;
+    x) EXTRA=$OPTARG ;;
+    j) JOBS=$OPTARG ;;
+    o) OUTCSV=$OPTARG ;;
+    *) sed -n '3,/^####/{/^####/!p;}' "$0"; exit 1 ;;
+  esac
+done
+
+RESDIR=${OUTCSV%.csv}.res
+SHMDIR=$(mktemp -d "${TMPDIR_SHM:-/dev/shm}/sweep.XXXXXX" 2>/dev/null || mktemp -d)
+trap 'rm -rf "$SHMDIR"' EXIT
+mkdir -p "$RESDIR" && rm -f "$RESDIR"/*.res
+
+########## ------- decompress each trace once, in parallel ------- ################
+
+for t in $TRACES; do
+  echo "$t"
+done | xargs -P "$JOBS" -I{} sh -c "gunzip -c '$TRACEDIR/{}.mtr.gz' > '$SHMDIR/{}.mtr'" || exit 1
+
+########## ------- run the grid on $JOBS workers ------- ################
+# xargs hands the next point to whichever worker finishes first
+
+for t in $TRACES; do
+  for m in $MODES; do
+    for s in $L2SIZES; do
+      for a in $L2ASSOCS; do
+        for r in $REPLS; do
+          echo "$t $m $s $a $r"
+        done
+      done
+    done
+  done
+done | xargs -P "$JOBS" -L 1 sh -c '
+  # $0=extra args $1=shm dir $2=result dir, then trace mode size assoc repl
+  # the extra args go first so the grid flags after them take precedence
+  ./sim $0 -mode $4 -L2sizeKB $5 -L2assoc $6 -repl $7 \
+      -progressfile "$2/$3.m$4.S$5K.A$6.R$7.progress" "$1/$3.mtr" \
+      > "$2/$3.m$4.S$5K.A$6.R$7.res" || echo "FAILED: $3 mode $4 L2 $5 KB assoc $6 repl $7" >&2
+' "$EXTRA" "$SHMDIR" "$RESDIR"
+
+########## ------- collect every NAME : value stat into one table ------- ################
+
+awk '
+  FNR == 1 {
+    npoint++
+    split(FILENAME, p, "/"); name = p[length(p)]
+    sub(/\.res$/, "", name)
+    point[npoint] = name
+  }
+  /^[A-Z0-9_]+[ \t]+: +[-0-9.]+([eE][-+]?[0-9]+)?$/ {
+    key = $1; val = $NF
+    if (!(key in seen)) { seen[key] = ++ncol; col[ncol] = key }
+    stat[npoint, key] = val
+  }
+  END {
+    line = "trace,mode,l2_kb,l2_assoc,repl"
+    for (c = 1; c <= ncol; c++) line = line "," col[c]
+    print line
+    for (i = 1; i <= npoint; i++) {
+      split(point[i], f, ".")
+      sub(/^m/, "", f[2]); sub(/^S/, "", f[3]); sub(/K$/, "", f[3]); sub(/^A/, "", f[4]); sub(/^R/, "", f[5])
+      line = f[1] "," f[2] "," f[3] "," f[4] "," f[5]
+      for (c = 1; c <= ncol; c++) line = line "," stat[i, col[c]]
+      print line
+    }
+  }
+' "$RESDIR"/*.res > "$OUTCSV"
+
+echo "All Done. $(($(wc -l < "$OUTCSV") - 1)) points in $OUTCSV";
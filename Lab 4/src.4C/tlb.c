@@ -0,0 +1,216 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tlb.h"
+#include "hash.h"
+#include "stats.h"
+
+extern uns64  ITLB_ENTRIES;
+extern uns64  ITLB_ASSOC;
+extern uns64  DTLB_ENTRIES;
+extern uns64  DTLB_ASSOC;
+extern uns64  STLB_ENTRIES;
+extern uns64  STLB_ASSOC;
+extern uns64  STLB_LATENCY;
+extern uns64  HUGEPAGE_PCT;
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Tlb *tlb_new(uns64 entries, uns64 assoc){
+  Tlb *t = (Tlb *) calloc (1, sizeof (Tlb));
+
+  assert(assoc >= 1 && entries % assoc == 0);
+  t->num_ways = assoc;
+  t->num_sets = entries/assoc;
+  t->entries  = (Tlb_Entry *) calloc (entries, sizeof(Tlb_Entry));
+
+  return t;
+}
+
+static Tlb_Entry *tlb_find(Tlb *t, Addr vpn, Flag huge){
+  Tlb_Entry *set = &t->entries[(vpn % t->num_sets) * t->num_ways];
+  uns64 ii;
+
+  for(ii=0; ii<t->num_ways; ii++){
+    if(set[ii].valid && set[ii].vpn==vpn && set[ii].huge==huge){
+      return &set[ii];
+    }
+  }
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////
+// Probe both page sizes; a hit updates the LRU timestamp
+////////////////////////////////////////////////////////////////////
+
+Flag tlb_lookup(Tlb *t, Addr vaddr){
+  Tlb_Entry *e;
+
+  t->time++;
+  t->stat_access++;
+
+  e = tlb_find(t, vaddr >> TLB_PAGE_SHIFT, FALSE);
+  if(!e){
+    e = tlb_find(t, vaddr >> TLB_HUGE_SHIFT, TRUE);
+  }
+
+  if(!e){
+    t->stat_miss++;
+    return MISS;
+  }
+
+  e->last_access_time = t->time;
+  return HIT;
+}
+
+void tlb_install(Tlb *t, Addr vaddr, Flag huge){
+  Addr vpn = vaddr >> (huge ? TLB_HUGE_SHIFT : TLB_PAGE_SHIFT);
+  Tlb_Entry *set = &t->entries[(vpn % t->num_sets) * t->num_ways];
+  Tlb_Entry *victim = &set[0];
+  uns64 ii;
+
+  for(ii=0; ii<t->num_ways; ii++){
+    if(!set[ii].valid){
+      victim = &set[ii];
+      break;
+    }
+    if(set[ii].last_access_time < victim->last_access_time){
+      victim = &set[ii];
+    }
+  }
+
+  victim->valid = TRUE;
+  victim->huge  = huge;
+  victim->vpn   = vpn;
+  victim->last_access_time = t->time;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Mmu *mmu_new(void){
+  Mmu *m = (Mmu *) calloc (1, sizeof (Mmu));
+
+  m->itlb = tlb_new(ITLB_ENTRIES, ITLB_ASSOC);
+  m->dtlb = tlb_new(DTLB_ENTRIES, DTLB_ASSOC);
+  m->stlb = tlb_new(STLB_ENTRIES, STLB_ASSOC);
+  m->stlb_latency = STLB_LATENCY;
+  m->huge_pct = HUGEPAGE_PCT;
+
+  return m;
+}
+
+static Flag mmu_is_huge(Mmu *m, Addr vaddr){
+  return (hash_mix(vaddr >> TLB_HUGE_SHIFT) % 100) < m->huge_pct;
+}
+
+////////////////////////////////////////////////////////////////////
+// Page table entry read at each level of the walk. Every table page
+// is placed in a frame picked by hashing its level and the virtual
+// address bits above it, so different tables rarely share lines.
+////////////////////////////////////////////////////////////////////
+
+static uns mmu_walk_addrs(Addr vaddr, Flag huge, Addr *walk_addrs){
+  uns levels = huge ? MMU_LEVELS-1 : MMU_LEVELS;
+  uns level;
+
+  for(level=0; level<levels; level++){
+    uns   shift  = TLB_PAGE_SHIFT + MMU_LEVEL_BITS*(MMU_LEVELS-1-level);
+    Addr  index  = (vaddr >> shift) & ((1ULL<<MMU_LEVEL_BITS)-1);
+    Addr  prefix = (shift + MMU_LEVEL_BITS < 64) ? vaddr >> (shift + MMU_LEVEL_BITS) : 0;
+    Addr  frame  = hash_mix((prefix << 2) | level) % MMU_PT_PAGES;
+
+    walk_addrs[level] = MMU_PT_BASE + (frame << TLB_PAGE_SHIFT) + index*MMU_PTE_BYTES;
+  }
+
+  return levels;
+}
+
+////////////////////////////////////////////////////////////////////
+// Returns the TLB latency of the access. On an STLB miss the page
+// table entries to read are returned in walk_addrs/num_walk and the
+// translation is installed; the caller reads them and then calls
+// mmu_walk_done with their delay.
+////////////////////////////////////////////////////////////////////
+
+uns64 mmu_translate(Mmu *m, Addr vaddr, Flag is_ifetch, Addr *walk_addrs, uns *num_walk){
+  Tlb  *l1 = is_ifetch ? m->itlb : m->dtlb;
+  Flag  huge;
+
+  *num_walk = 0;
+  if(tlb_lookup(l1, vaddr)==HIT){
+    return 0;
+  }
+
+  m->stat_xlate_cycles += m->stlb_latency;
+  huge = mmu_is_huge(m, vaddr);
+
+  if(tlb_lookup(m->stlb, vaddr)==MISS){
+    *num_walk = mmu_walk_addrs(vaddr, huge, walk_addrs);
+    m->stat_walks++;
+    m->stat_walk_huge += huge;
+    m->stat_walk_accesses += *num_walk;
+    tlb_install(m->stlb, vaddr, huge);
+  }
+
+  tlb_install(l1, vaddr, huge);
+  return m->stlb_latency;
+}
+
+void mmu_walk_done(Mmu *m, uns64 walk_cycles){
+  m->stat_walk_cycles  += walk_cycles;
+  m->stat_xlate_cycles += walk_cycles;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void mmu_register_stats(Mmu *m){
+  stats_register("ITLB", "ACCESS", &m->itlb->stat_access);
+  stats_register("ITLB", "MISS",   &m->itlb->stat_miss);
+  stats_register("DTLB", "ACCESS", &m->dtlb->stat_access);
+  stats_register("DTLB", "MISS",   &m->dtlb->stat_miss);
+  stats_register("STLB", "ACCESS", &m->stlb->stat_access);
+  stats_register("STLB", "MISS",   &m->stlb->stat_miss);
+  stats_register("MMU",  "WALKS",         &m->stat_walks);
+  stats_register("MMU",  "WALKS_HUGE",    &m->stat_walk_huge);
+  stats_register("MMU",  "WALK_ACCESSES", &m->stat_walk_accesses);
+  stats_register("MMU",  "WALK_CYCLES",   &m->stat_walk_cycles);
+  stats_register("MMU",  "XLATE_CYCLES",  &m->stat_xlate_cycles);
+}
+
+static void tlb_print(Tlb *t, char *header){
+  double mr = 0;
+
+  if(t->stat_access){
+    mr = (double)(t->stat_miss)/(double)(t->stat_access);
+  }
+
+  printf("\n%s_ACCESS         \t\t : %10llu", header, t->stat_access);
+  printf("\n%s_MISS           \t\t : %10llu", header, t->stat_miss);
+  printf("\n%s_MISSPERC       \t\t : %10.3f", header, 100*mr);
+}
+
+void mmu_print(Mmu *m){
+  char   header[256];
+  double walk_avg = 0;
+
+  sprintf(header, "MMU");
+
+  if(m->stat_walks){
+    walk_avg = (double)(m->stat_walk_cycles)/(double)(m->stat_walks);
+  }
+
+  printf("\n");
+  tlb_print(m->itlb, "ITLB");
+  tlb_print(m->dtlb, "DTLB");
+  tlb_print(m->stlb, "STLB");
+  printf("\n%s_WALKS           \t\t : %10llu", header, m->stat_walks);
+  printf("\n%s_WALKS_HUGE      \t\t : %10llu", header, m->stat_walk_huge);
+  printf("\n%s_WALK_ACCESSES   \t\t : %10llu", header, m->stat_walk_accesses);
+  printf("\n%s_WALK_AVGDELAY   \t\t : %10.3f", header, walk_avg);
+  printf("\n%s_XLATE_CYCLES    \t\t : %10llu", header, m->stat_xlate_cycles);
+  printf("\n");
+}
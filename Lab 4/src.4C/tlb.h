@@ -0,0 +1,80 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include "types.h"
+
+#define TLB_PAGE_SHIFT       12  // 4 KB base pages
+#define TLB_HUGE_SHIFT       21  // 2 MB huge pages
+#define MMU_LEVELS           4   // x86-64 style radix page table
+#define MMU_LEVEL_BITS       9   // 512 entries per table page
+#define MMU_PTE_BYTES        8
+#define MMU_PT_BASE          (1ULL<<52) // page tables live above the trace addresses
+#define MMU_PT_PAGES         (1ULL<<28) // page table pages are hashed into this many frames
+
+//////////////////////////////////////////////////////////////////
+// Address translation in front of memsys (-tlb 1): split L1
+// ITLB/DTLB, a unified L2 STLB and a hardware page walker.
+//
+// Entries are tagged with their page size, so a lookup probes the
+// 4 KB and the 2 MB virtual page number. Which 2 MB regions are
+// backed by huge pages is decided by hashing the region number
+// (-hugepages percent), so the choice is fixed for a whole run.
+//
+// On an STLB miss mmu_translate returns the page table entry
+// addresses to read (4 for a 4 KB page, 3 for a 2 MB page); memsys
+// issues them through memsys_L2_access, one after the other.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Tlb_Entry Tlb_Entry;
+typedef struct Tlb Tlb;
+typedef struct Mmu Mmu;
+
+
+struct Tlb_Entry {
+  Flag   valid;
+  Flag   huge;
+  Addr   vpn;
+  uns64  last_access_time; // for LRU
+};
+
+
+struct Tlb {
+  uns64      num_sets;
+  uns64      num_ways;
+  Tlb_Entry *entries;      // num_sets * num_ways
+  uns64      time;         // LRU timestamp, one tick per lookup
+
+  uns64      stat_access;
+  uns64      stat_miss;
+};
+
+
+struct Mmu {
+  Tlb   *itlb;
+  Tlb   *dtlb;
+  Tlb   *stlb;
+  uns64  stlb_latency;     // extra cycles for an L1 TLB miss
+  uns64  huge_pct;         // percent of 2 MB regions on huge pages
+
+  uns64  stat_walks;
+  uns64  stat_walk_huge;
+  uns64  stat_walk_accesses;
+  uns64  stat_walk_cycles;  // memsys_L2_access delay of the walks
+  uns64  stat_xlate_cycles; // delay added to accesses: STLB latency + walks
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Tlb   *tlb_new(uns64 entries, uns64 assoc);
+Flag   tlb_lookup(Tlb *t, Addr vaddr);
+void   tlb_install(Tlb *t, Addr vaddr, Flag huge);
+
+Mmu   *mmu_new(void);
+uns64  mmu_translate(Mmu *m, Addr vaddr, Flag is_ifetch, Addr *walk_addrs, uns *num_walk);
+void   mmu_walk_done(Mmu *m, uns64 walk_cycles);
+void   mmu_register_stats(Mmu *m);
+void   mmu_print(Mmu *m);
+
+#endif // TLB_H
@@ -0,0 +1,305 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracegen.h"
+
+extern uns64  SYNTH_INSTS;
+extern uns64  SYNTH_SEED;
+extern uns64  SYNTH_MEM_PCT;
+extern uns64  SYNTH_STORE_PCT;
+extern uns64  SYNTH_STREAM_PCT;
+extern uns64  SYNTH_CHASE_PCT;
+extern uns64  SYNTH_ZIPF_PCT;
+extern uns64  SYNTH_STREAM_SIZE;
+extern uns64  SYNTH_STRIDE;
+extern uns64  SYNTH_CHASE_SIZE;
+extern uns64  SYNTH_ZIPF_SIZE;
+extern uns64  SYNTH_ZIPF_THETA;
+extern uns64  SYNTH_CODE_SIZE;
+extern uns64  TRACE64;
+
+void die_message(const char * msg);
+
+#define TRACEGEN_REC_BYTES   9
+#define TRACEGEN_REC64_BYTES 17
+
+//////////////////////////////////////////////////////////////////
+// xorshift64*, seeded through splitmix64 so that small seeds
+// (1, 2, ...) give unrelated streams
+//////////////////////////////////////////////////////////////////
+
+static uns64 tracegen_mix(uns64 x){
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x>>30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x>>27)) * 0x94D049BB133111EBULL;
+  return x ^ (x>>31);
+}
+
+static inline uns64 tracegen_rand(Tracegen *g){
+  g->rng ^= g->rng >> 12;
+  g->rng ^= g->rng << 25;
+  g->rng ^= g->rng >> 27;
+  return g->rng * 0x2545F4914F6CDD1DULL;
+}
+
+// uniform in [0,1)
+static inline double tracegen_rand_unit(Tracegen *g){
+  return (double)(tracegen_rand(g) >> 11) * (1.0/9007199254740992.0);
+}
+
+//////////////////////////////////////////////////////////////////
+// Zipf over n items, YCSB style (Gray et al., "Quickly generating
+// billion-record synthetic databases"). zeta(n) is summed exactly for
+// the first TRACEGEN_ZETA_EXACT terms and the tail is integrated.
+//////////////////////////////////////////////////////////////////
+
+static double tracegen_zeta(uns64 n, double theta){
+  uns64  exact = (n < TRACEGEN_ZETA_EXACT) ? n : TRACEGEN_ZETA_EXACT;
+  double sum = 0;
+  uns64  ii;
+
+  for(ii=1; ii<=exact; ii++){
+    sum += pow((double)ii, -theta);
+  }
+  if(n > exact){
+    // sum of i^-theta for i in (exact, n], midpoint rule
+    sum += (pow((double)n + 0.5, 1.0-theta) - pow((double)exact + 0.5, 1.0-theta)) / (1.0-theta);
+  }
+
+  return sum;
+}
+
+static void tracegen_zipf_init(Tracegen *g, uns64 n, double theta){
+  double zeta2 = tracegen_zeta(2, theta);
+
+  g->zipf_items    = n;
+  g->zipf_theta    = theta;
+  g->zipf_zetan    = tracegen_zeta(n, theta);
+  g->zipf_alpha    = 1.0/(1.0-theta);
+  g->zipf_eta      = (1.0 - pow(2.0/(double)n, 1.0-theta)) / (1.0 - zeta2/g->zipf_zetan);
+  g->zipf_half_pow = 1.0 + pow(0.5, theta);
+}
+
+static inline uns64 tracegen_zipf_next(Tracegen *g){
+  double u  = tracegen_rand_unit(g);
+  double uz = u * g->zipf_zetan;
+  uns64  rank;
+
+  if(uz < 1.0){
+    rank = 0;
+  }else if(uz < g->zipf_half_pow){
+    rank = 1;
+  }else{
+    rank = (uns64)((double)g->zipf_items * pow(g->zipf_eta*u - g->zipf_eta + 1.0, g->zipf_alpha));
+    if(rank >= g->zipf_items){
+      rank = g->zipf_items-1;
+    }
+  }
+
+  // spread the hot items over the region instead of packing them
+  // at its start (2654435761 is prime, so this is a permutation)
+  return (rank * 2654435761ULL) % g->zipf_items;
+}
+
+//////////////////////////////////////////////////////////////////
+// Pointer chase: a full-period LCG mod 2^k walks every node once per
+// lap, and a bijective scramble of its state picks the node, so the
+// walk has no spatial order and needs no next-pointer table
+//////////////////////////////////////////////////////////////////
+
+static inline uns64 tracegen_chase_next(Tracegen *g){
+  uns64 mask = g->chase_nodes-1;
+  uns64 x;
+
+  g->chase_pos = (g->chase_pos * 6364136223846793005ULL + 1442695040888963407ULL) & mask;
+  x = (g->chase_pos * 0x9E3779B97F4A7C15ULL) & mask;
+  return x ^ (x >> 7);
+}
+
+//////////////////////////////////////////////////////////////////
+// Fix what each static instruction does: its type and, for loads
+// and stores, the address model. Kept in a table over the code
+// footprint so the per-record work is a lookup.
+//////////////////////////////////////////////////////////////////
+
+static void tracegen_assign_pcs(Tracegen *g){
+  uns64 ii;
+
+  for(ii=0; ii<g->code_insts; ii++){
+    uns64 h = tracegen_mix(SYNTH_SEED ^ (TRACEGEN_CODE_BASE + 4*ii));
+    uns   type = INST_TYPE_ALU;
+    uns   model = TRACEGEN_MODEL_NONE;
+    uns64 pick;
+
+    if(h % 100 < SYNTH_MEM_PCT){
+      type = ((h>>16) % 100 < SYNTH_STORE_PCT) ? INST_TYPE_STORE : INST_TYPE_LOAD;
+      pick = (h>>32) % 100;
+      if(pick < SYNTH_STREAM_PCT){
+	model = TRACEGEN_MODEL_STREAM;
+      }else if(pick < SYNTH_STREAM_PCT + SYNTH_CHASE_PCT){
+	model = TRACEGEN_MODEL_CHASE;
+      }else{
+	model = TRACEGEN_MODEL_ZIPF;
+      }
+    }
+
+    g->pc_kind[ii] = (uns8)(type | (model << 2));
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+static Addr tracegen_region(Addr *next, uns64 size){
+  Addr base = *next;
+
+  *next = (base + size + TRACEGEN_REGION_ALIGN-1) & ~(TRACEGEN_REGION_ALIGN-1);
+  return base;
+}
+
+Tracegen *tracegen_new(void){
+  Tracegen *g = (Tracegen *) calloc (1, sizeof (Tracegen));
+  Addr next = TRACEGEN_DATA_BASE;
+
+  g->num_insts  = SYNTH_INSTS;
+  g->rng        = tracegen_mix(SYNTH_SEED) | 1; // xorshift state must not be 0
+
+  g->code_insts = SYNTH_CODE_SIZE/4;
+  g->pc_kind    = (uns8 *) calloc (g->code_insts, sizeof(uns8));
+  g->pc         = TRACEGEN_CODE_BASE;
+  g->block_left = TRACEGEN_BLOCK_INSTS;
+  tracegen_assign_pcs(g);
+
+  g->stream_base  = tracegen_region(&next, SYNTH_STREAM_SIZE);
+  g->stream_bytes = SYNTH_STREAM_SIZE;
+  g->stride       = SYNTH_STRIDE;
+
+  g->chase_base   = tracegen_region(&next, SYNTH_CHASE_SIZE);
+  g->chase_nodes  = SYNTH_CHASE_SIZE/TRACEGEN_NODE_BYTES;
+
+  g->zipf_base    = tracegen_region(&next, SYNTH_ZIPF_SIZE);
+  tracegen_zipf_init(g, SYNTH_ZIPF_SIZE/TRACEGEN_NODE_BYTES, (double)SYNTH_ZIPF_THETA/100.0);
+
+  g->data_end     = next;
+  if(!TRACE64 && g->data_end > (1ULL<<32)){
+    die_message("synth data regions do not fit 32-bit addresses, shrink them or use -trace64 1");
+  }
+
+  return g;
+}
+
+//////////////////////////////////////////////////////////////////
+// Produce up to max_recs records; fewer means the trace has ended
+//////////////////////////////////////////////////////////////////
+
+uns64 tracegen_fill(Tracegen *g, Trace_Rec *recs, uns64 max_recs){
+  uns64 num_recs = g->num_insts - g->done_insts;
+  uns64 ii;
+
+  if(num_recs > max_recs){
+    num_recs = max_recs;
+  }
+
+  for(ii=0; ii<num_recs; ii++){
+    uns kind = g->pc_kind[(g->pc - TRACEGEN_CODE_BASE) >> 2];
+    Addr ldst_addr = 0;
+
+    switch(kind >> 2){
+    case TRACEGEN_MODEL_STREAM:
+      ldst_addr = g->stream_base + g->stream_pos;
+      g->stream_pos += g->stride;
+      if(g->stream_pos >= g->stream_bytes){
+	g->stream_pos -= g->stream_bytes;
+      }
+      break;
+    case TRACEGEN_MODEL_CHASE:
+      ldst_addr = g->chase_base + tracegen_chase_next(g)*TRACEGEN_NODE_BYTES;
+      break;
+    case TRACEGEN_MODEL_ZIPF:
+      ldst_addr = g->zipf_base + tracegen_zipf_next(g)*TRACEGEN_NODE_BYTES;
+      break;
+    }
+
+    recs[ii].inst_addr = g->pc;
+    recs[ii].inst_type = (Inst_Type)(kind & 3);
+    recs[ii].ldst_addr = ldst_addr;
+
+    // next instruction: fall through, or at the end of a block
+    // continue with the next block or jump to a random one
+    if(--g->block_left){
+      g->pc += 4;
+    }else{
+      uns64 blocks = g->code_insts/TRACEGEN_BLOCK_INSTS;
+      uns64 r = tracegen_rand(g);
+      uns64 block = (g->pc - TRACEGEN_CODE_BASE)/(4*TRACEGEN_BLOCK_INSTS) + 1;
+
+      if(r % 100 < TRACEGEN_JUMP_PCT){
+	block = (r >> 32) % blocks;
+      }
+      if(block >= blocks){
+	block = 0;
+      }
+      g->pc = TRACEGEN_CODE_BASE + block*4*TRACEGEN_BLOCK_INSTS;
+      g->block_left = TRACEGEN_BLOCK_INSTS;
+    }
+  }
+
+  g->done_insts += num_recs;
+  return num_recs;
+}
+
+//////////////////////////////////////////////////////////////////
+// Write the whole trace in the record format sim.c reads,
+// through gzip if the name ends in .gz
+//////////////////////////////////////////////////////////////////
+
+uns64 tracegen_write(Tracegen *g, const char *filename, Flag trace64){
+  static Trace_Rec recs[TRACEGEN_WRITE_BATCH];
+  static uns8      buf[TRACEGEN_WRITE_BATCH * TRACEGEN_REC64_BYTES];
+  uns   rec_bytes = trace64 ? TRACEGEN_REC64_BYTES : TRACEGEN_REC_BYTES;
+  uns   addr_bytes = trace64 ? 8 : 4;
+  size_t len = strlen(filename);
+  Flag  gz = (len >= 3 && !strcmp(filename + len - 3, ".gz"));
+  uns64 total = 0, num_recs, ii;
+  FILE *fp;
+  char  msg[1100];
+
+  if(gz){
+    sprintf(msg, "gzip -c > %.1000s", filename);
+    fp = popen(msg, "w");
+  }else{
+    fp = fopen(filename, "wb");
+  }
+  if(fp == NULL){
+    sprintf(msg, "Unable to open the synthetic trace output %.1000s", filename);
+    die_message(msg);
+  }
+
+  while((num_recs = tracegen_fill(g, recs, TRACEGEN_WRITE_BATCH)) > 0){
+    for(ii=0; ii<num_recs; ii++){
+      uns8 *rec = &buf[ii*rec_bytes];
+
+      // little-endian, as sim.c reads it
+      memcpy(rec, &recs[ii].inst_addr, addr_bytes);
+      rec[addr_bytes] = (uns8)recs[ii].inst_type;
+      memcpy(rec+addr_bytes+1, &recs[ii].ldst_addr, addr_bytes);
+    }
+    if(fwrite(buf, rec_bytes, num_recs, fp) != num_recs){
+      die_message("Unable to write the synthetic trace");
+    }
+    total += num_recs;
+  }
+
+  if(gz){
+    if(pclose(fp) != 0){
+      die_message("gzip failed writing the synthetic trace");
+    }
+  }else{
+    fclose(fp);
+  }
+
+  return total;
+}
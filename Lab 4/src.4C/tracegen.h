@@ -0,0 +1,87 @@
+#ifndef TRACEGEN_H
+#define TRACEGEN_H
+
+#include "types.h"
+
+#define TRACEGEN_CODE_BASE   0x00400000ULL
+#define TRACEGEN_DATA_BASE   0x10000000ULL
+#define TRACEGEN_REGION_ALIGN (1ULL<<20)  // data regions start on 1 MB boundaries
+#define TRACEGEN_BLOCK_INSTS 8            // instructions per basic block (4 B each)
+#define TRACEGEN_JUMP_PCT    25           // blocks ending in a jump to a random block
+#define TRACEGEN_NODE_BYTES  64           // pointer-chase node / Zipf item size
+#define TRACEGEN_ZETA_EXACT  (1ULL<<20)   // Zipf zeta summed exactly up to here
+#define TRACEGEN_WRITE_BATCH 4096         // records per fwrite for -synthout
+
+typedef enum Tracegen_Model_Enum {
+    TRACEGEN_MODEL_NONE=0,    // not a load/store
+    TRACEGEN_MODEL_STREAM=1,
+    TRACEGEN_MODEL_CHASE=2,
+    TRACEGEN_MODEL_ZIPF=3,
+} Tracegen_Model;
+
+//////////////////////////////////////////////////////////////////
+// Synthetic trace generator (-synth): instruction records in the
+// order sim.c reads them, from a parameterized workload model.
+//
+// Code: TRACEGEN_BLOCK_INSTS-instruction blocks spread over
+// SYNTH_CODE_KB; a block falls through to the next one or, 1 in 4
+// times, jumps to a random block.
+//
+// Data: what an instruction does is a fixed function of its PC (a
+// hash), as in real code, so PC-indexed predictors can learn it.
+// SYNTH_MEM_PCT of the PCs are loads/stores, SYNTH_STORE_PCT of those
+// stores, and each memory PC follows one of three models, split by
+// SYNTH_STREAM_PCT / SYNTH_CHASE_PCT / SYNTH_ZIPF_PCT:
+//
+//   stream: a cursor sweeping SYNTH_STREAM_KB in SYNTH_STRIDE steps
+//   chase:  a pointer chase visiting every node of SYNTH_CHASE_KB
+//           in a pseudo-random cycle (full-period LCG, no table)
+//   zipf:   items of SYNTH_ZIPF_KB drawn with skew SYNTH_ZIPF_THETA
+//           (in hundredths, YCSB method), ranks scattered by a hash
+//
+// The same SYNTH_SEED gives the same trace, in-process or written
+// out with -synthout.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Tracegen Tracegen;
+
+
+struct Tracegen {
+  uns64  num_insts;      // records to generate
+  uns64  done_insts;
+  uns64  rng;            // xorshift64* state
+
+  Addr   pc;             // next instruction
+  uns64  code_insts;
+  uns8  *pc_kind;        // per static instruction: Inst_Type | Tracegen_Model<<2
+  uns    block_left;     // instructions left in the current block
+
+  Addr   stream_base;
+  uns64  stream_bytes;
+  uns64  stream_pos;
+  uns64  stride;
+
+  Addr   chase_base;
+  uns64  chase_nodes;    // power of two
+  uns64  chase_pos;
+
+  Addr   zipf_base;
+  uns64  zipf_items;
+  double zipf_theta;
+  double zipf_zetan;
+  double zipf_alpha;
+  double zipf_eta;
+  double zipf_half_pow;  // 1 + 0.5^theta
+
+  Addr   data_end;       // first byte past the data regions
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Tracegen *tracegen_new(void);
+uns64   tracegen_fill(Tracegen *g, Trace_Rec *recs, uns64 max_recs);
+uns64   tracegen_write(Tracegen *g, const char *filename, Flag trace64);
+
+#endif // TRACEGEN_H
@@ -40,6 +40,14 @@ typedef enum Access_Type_Enum {
 } Access_Type;
 
 
+// One decoded trace record (one instruction)
+typedef struct Trace_Rec {
+    Addr      inst_addr;
+    Addr      ldst_addr;
+    Inst_Type inst_type;
+} Trace_Rec;
+
+
 typedef enum MODE_Enum {
     SIM_MODE_NONE=0,
     SIM_MODE_A=1,
@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wcb.h"
+#include "stats.h"
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Wcb *wcb_new(uns64 num_entries){
+  Wcb *w = (Wcb *) calloc (1, sizeof (Wcb));
+
+  assert(num_entries);
+  w->num_entries = num_entries;
+  w->entries = (Wcb_Entry *) calloc (num_entries, sizeof(Wcb_Entry));
+
+  return w;
+}
+
+////////////////////////////////////////////////////////////////////
+// Buffer a write of the sectors in mask. Returns TRUE if an entry
+// was pushed out to make room; the caller writes it to the next level
+////////////////////////////////////////////////////////////////////
+
+Flag wcb_write(Wcb *w, Addr lineaddr, uns64 mask, Addr *out_lineaddr, uns64 *out_mask){
+  Wcb_Entry *victim = NULL;
+  Flag       evicted = FALSE;
+  uns64      ii;
+
+  w->stat_writes++;
+
+  for(ii=0; ii<w->num_entries; ii++){
+    Wcb_Entry *e = &w->entries[ii];
+
+    if(e->valid && e->lineaddr == lineaddr){
+      e->mask |= mask;
+      w->stat_merges++;
+      return FALSE;
+    }
+    if(!e->valid){
+      if(victim == NULL || victim->valid){
+        victim = e;
+      }
+    }else if(victim == NULL || (victim->valid && e->alloc_seq < victim->alloc_seq)){
+      victim = e;
+    }
+  }
+
+  if(victim->valid){
+    *out_lineaddr = victim->lineaddr;
+    *out_mask = victim->mask;
+    w->stat_evicts++;
+    evicted = TRUE;
+  }
+
+  victim->valid = TRUE;
+  victim->lineaddr = lineaddr;
+  victim->mask = mask;
+  victim->alloc_seq = w->seq++;
+
+  return evicted;
+}
+
+////////////////////////////////////////////////////////////////////
+// A read of lineaddr: take its entry out of the buffer, if any
+////////////////////////////////////////////////////////////////////
+
+Flag wcb_take(Wcb *w, Addr lineaddr, uns64 *out_mask){
+  uns64 ii;
+
+  for(ii=0; ii<w->num_entries; ii++){
+    Wcb_Entry *e = &w->entries[ii];
+
+    if(e->valid && e->lineaddr == lineaddr){
+      *out_mask = e->mask;
+      e->valid = FALSE;
+      w->stat_read_flushes++;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////
+// End of the run: take out the oldest entry, FALSE once empty
+////////////////////////////////////////////////////////////////////
+
+Flag wcb_drain(Wcb *w, Addr *out_lineaddr, uns64 *out_mask){
+  Wcb_Entry *oldest = NULL;
+  uns64      ii;
+
+  for(ii=0; ii<w->num_entries; ii++){
+    Wcb_Entry *e = &w->entries[ii];
+
+    if(e->valid && (oldest == NULL || e->alloc_seq < oldest->alloc_seq)){
+      oldest = e;
+    }
+  }
+
+  if(oldest == NULL){
+    return FALSE;
+  }
+
+  *out_lineaddr = oldest->lineaddr;
+  *out_mask = oldest->mask;
+  oldest->valid = FALSE;
+  return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+void wcb_register_stats(Wcb *w, char *header){
+  stats_register(header, "WRITES",       &w->stat_writes);
+  stats_register(header, "MERGES",       &w->stat_merges);
+  stats_register(header, "EVICTS",       &w->stat_evicts);
+  stats_register(header, "READ_FLUSHES", &w->stat_read_flushes);
+}
+
+void wcb_print(Wcb *w, char *header){
+  double merge_rate = 0;
+
+  if(w->stat_writes){
+    merge_rate = (double)(w->stat_merges)/(double)(w->stat_writes);
+  }
+
+  printf("\n");
+  printf("\n%s_ENTRIES        \t\t : %10llu", header, w->num_entries);
+  printf("\n%s_WRITES         \t\t : %10llu", header, w->stat_writes);
+  printf("\n%s_MERGES         \t\t : %10llu", header, w->stat_merges);
+  printf("\n%s_EVICTS         \t\t : %10llu", header, w->stat_evicts);
+  printf("\n%s_READ_FLUSHES   \t\t : %10llu", header, w->stat_read_flushes);
+  printf("\n%s_MERGE_RATE     \t\t : %10.3f", header, merge_rate);
+  printf("\n");
+}
@@ -0,0 +1,66 @@
+#ifndef WCB_H
+#define WCB_H
+
+#include "types.h"
+
+//////////////////////////////////////////////////////////////////
+// Write policies of the DCACHE and L2 (-Dwrite/-L2write for hits,
+// -Dwmiss/-L2wmiss for misses). A write to a level is a store for
+// the DCACHE, and a writeback, write-through or write-around from
+// the DCACHE for the L2.
+//////////////////////////////////////////////////////////////////
+
+typedef enum Write_Hit_Policy_Enum {
+    WRITE_BACK=0,       // mark the line dirty, write it on eviction
+    WRITE_THROUGH=1,    // keep the line clean, pass the write down
+} Write_Hit_Policy;
+
+typedef enum Write_Miss_Policy_Enum {
+    WRITE_ALLOCATE=0,   // fetch the line, then write it
+    WRITE_NO_ALLOCATE=1, // pass the write down, do not fill
+    WRITE_COMBINE=2,    // no fill, merge into a write-combining buffer
+} Write_Miss_Policy;
+
+//////////////////////////////////////////////////////////////////
+// Write-combining buffer for WRITE_COMBINE: a few line entries with
+// a mask of written sectors. Writes to a buffered line merge; a new
+// line takes a free entry or pushes out the oldest one, which the
+// caller writes to the next level. A read of a buffered line takes
+// the entry out first, so the read sees the data.
+//////////////////////////////////////////////////////////////////
+
+typedef struct Wcb_Entry Wcb_Entry;
+typedef struct Wcb Wcb;
+
+
+struct Wcb_Entry {
+  Flag   valid;
+  Addr   lineaddr;
+  uns64  mask;
+  uns64  alloc_seq;   // FIFO order
+};
+
+
+struct Wcb {
+  uns64      num_entries;
+  Wcb_Entry *entries;
+  uns64      seq;
+
+  uns64      stat_writes;
+  uns64      stat_merges;       // writes to a line already buffered
+  uns64      stat_evicts;       // entries pushed out by a new line
+  uns64      stat_read_flushes; // entries taken out by a read
+};
+
+
+//////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////
+
+Wcb   *wcb_new(uns64 num_entries);
+Flag   wcb_write(Wcb *w, Addr lineaddr, uns64 mask, Addr *out_lineaddr, uns64 *out_mask);
+Flag   wcb_take(Wcb *w, Addr lineaddr, uns64 *out_mask);
+Flag   wcb_drain(Wcb *w, Addr *out_lineaddr, uns64 *out_mask);
+void   wcb_register_stats(Wcb *w, char *header);
+void   wcb_print(Wcb *w, char *header);
+
+#endif // WCB_H